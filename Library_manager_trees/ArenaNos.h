@@ -0,0 +1,97 @@
+#ifndef ARENA_NOS_H
+#define ARENA_NOS_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Bloco contíguo de nós de uma árvore, usado pelas reconstruções (compactação e
+// remoção em lote). Os nós são criados um após o outro na ordem em que a
+// reconstrução os pede, de modo que a vizinhança na memória não depende do alocador.
+// Um nó da arena removido depois da reconstrução é destruído na hora, mas sua posição
+// só volta a ser usada quando a arena inteira é liberada, na próxima reconstrução.
+// Nós criados fora da arena (inserções comuns) convivem com ela: descartar() sabe de
+// onde cada nó veio.
+template <typename No>
+class ArenaNos {
+public:
+    ArenaNos() : memoria(nullptr), capacidade(0), usados(0) {}
+
+    ~ArenaNos() {
+        liberar();
+    }
+
+    // A arena é dona do bloco; é trocada com swap, nunca copiada.
+    ArenaNos(const ArenaNos&) = delete;
+    ArenaNos& operator=(const ArenaNos&) = delete;
+
+    // Reserva um bloco para exatamente n nós. Só pode ser chamada com a arena vazia.
+    void reservar(size_t n) {
+        liberar();
+        if (n == 0) return;
+        memoria = static_cast<No*>(::operator new(n * sizeof(No)));
+        capacidade = n;
+        vivo.assign(n, false);
+    }
+
+    // Cria um nó na próxima posição livre do bloco. Se a reserva acabou, o nó vem do
+    // alocador comum, o que só custa a proximidade.
+    template <typename... Argumentos>
+    No* criar(Argumentos&&... argumentos) {
+        if (usados == capacidade) {
+            return new No(forward<Argumentos>(argumentos)...);
+        }
+        No* node = new (memoria + usados) No(forward<Argumentos>(argumentos)...);
+        vivo[usados++] = true;
+        return node;
+    }
+
+    // Indica se o nó está no bloco desta arena.
+    bool contem(const No* node) const {
+        return node >= memoria && node < memoria + usados;
+    }
+
+    // Destrói um nó, seja da arena ou do alocador comum.
+    void descartar(No* node) {
+        if (contem(node)) {
+            node->~No();
+            vivo[node - memoria] = false;
+        } else {
+            delete node;
+        }
+    }
+
+    // Número de posições do bloco já usadas, inclusive as de nós descartados.
+    size_t tamanho() const {
+        return usados;
+    }
+
+    // Destrói os nós que ainda estão vivos e devolve o bloco.
+    void liberar() {
+        for (size_t i = 0; i < usados; i++) {
+            if (vivo[i]) memoria[i].~No();
+        }
+        ::operator delete(memoria);
+        memoria = nullptr;
+        capacidade = usados = 0;
+        vivo.clear();
+    }
+
+    friend void swap(ArenaNos& a, ArenaNos& b) {
+        std::swap(a.memoria, b.memoria);
+        std::swap(a.capacidade, b.capacidade);
+        std::swap(a.usados, b.usados);
+        a.vivo.swap(b.vivo);
+    }
+
+private:
+    No* memoria;         // Início do bloco.
+    size_t capacidade;   // Nós que cabem no bloco.
+    size_t usados;       // Posições já entregues por criar().
+    vector<bool> vivo;   // Se cada posição usada ainda guarda um nó.
+};
+
+#endif // ARENA_NOS_H
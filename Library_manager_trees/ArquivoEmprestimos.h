@@ -0,0 +1,338 @@
+#ifndef ARQUIVO_EMPRESTIMOS_H
+#define ARQUIVO_EMPRESTIMOS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include "Emprestimo.h"
+
+using namespace std;
+
+// Segmento imutável do arquivo histórico. Os empréstimos ficam ordenados pela chave
+// e divididos em blocos de tamanho fixo. Dentro de cada bloco, cada registro guarda
+// só o que difere do anterior: o ISBN e o usuário são codificados pelo prefixo comum
+// e pelo sufixo, e as datas viram números de dias gravados como diferenças. O índice
+// esparso guarda apenas a primeira chave de cada bloco, então uma busca decodifica
+// um ou dois blocos em vez do segmento inteiro.
+class SegmentoArquivo {
+public:
+    static const size_t REGISTROS_POR_BLOCO = 64;
+
+    // Constrói o segmento a partir de empréstimos ordenados pela chave.
+    SegmentoArquivo(const vector<Emprestimo>& ordenados) : total(ordenados.size()) {
+        for (size_t i = 0; i < ordenados.size(); i++) {
+            if (i % REGISTROS_POR_BLOCO == 0) {
+                primeiraChave.push_back(ordenados[i].tituloLivro);
+                deslocamento.push_back(dados.size());
+            }
+            const Emprestimo* anterior = (i % REGISTROS_POR_BLOCO == 0) ? nullptr : &ordenados[i - 1];
+            codificar(ordenados[i], anterior);
+        }
+        dados.shrink_to_fit();
+    }
+
+    // Acrescenta a resultado todos os empréstimos do ISBN. Retorna quantos achou.
+    size_t buscar(const string& isbn, vector<Emprestimo>& resultado) const {
+        // Registros com a mesma chave podem começar no fim do bloco anterior.
+        size_t bloco = lower_bound(primeiraChave.begin(), primeiraChave.end(), isbn) - primeiraChave.begin();
+        if (bloco > 0) bloco--;
+
+        size_t achados = 0;
+        for (; bloco < primeiraChave.size() && primeiraChave[bloco] <= isbn; bloco++) {
+            size_t pos = deslocamento[bloco];
+            Emprestimo atual;
+            for (size_t i = 0; i < registrosNoBloco(bloco); i++) {
+                decodificar(pos, atual);
+                if (atual.tituloLivro == isbn) {
+                    resultado.push_back(atual);
+                    achados++;
+                } else if (atual.tituloLivro > isbn) {
+                    return achados;
+                }
+            }
+        }
+        return achados;
+    }
+
+    // Chama visitar para cada empréstimo do segmento, em ordem de chave.
+    template <typename Visitante>
+    void percorrer(Visitante visitar) const {
+        for (size_t bloco = 0; bloco < primeiraChave.size(); bloco++) {
+            size_t pos = deslocamento[bloco];
+            Emprestimo atual;
+            for (size_t i = 0; i < registrosNoBloco(bloco); i++) {
+                decodificar(pos, atual);
+                visitar(atual);
+            }
+        }
+    }
+
+    // Número de empréstimos no segmento.
+    size_t tamanho() const {
+        return total;
+    }
+
+    // Memória ocupada pelos blocos e pelo índice esparso.
+    size_t bytes() const {
+        size_t soma = dados.capacity() + deslocamento.capacity() * sizeof(uint64_t);
+        for (const auto& chave : primeiraChave) {
+            soma += sizeof(string) + chave.capacity();
+        }
+        return soma;
+    }
+
+private:
+    vector<uint8_t> dados;         // Blocos codificados, um após o outro.
+    vector<string> primeiraChave;  // Índice esparso: primeira chave de cada bloco.
+    vector<uint64_t> deslocamento; // Início de cada bloco em dados; segmentos podem passar de 4 GiB.
+    size_t total;                  // Número de empréstimos.
+
+    size_t registrosNoBloco(size_t bloco) const {
+        size_t restantes = total - bloco * REGISTROS_POR_BLOCO;
+        return restantes < REGISTROS_POR_BLOCO ? restantes : REGISTROS_POR_BLOCO;
+    }
+
+    // Converte "dd-mm-aaaa" em um número de dias que preserva a ordem das datas.
+    // Retorna -1 se o texto não estiver nesse formato.
+    static long long diaDaData(const string& data) {
+        if (data.size() != 10 || data[2] != '-' || data[5] != '-') return -1;
+        long long campos[3] = {0, 0, 0};
+        const size_t inicio[3] = {0, 3, 6}, tamanho[3] = {2, 2, 4};
+        for (int c = 0; c < 3; c++) {
+            for (size_t i = inicio[c]; i < inicio[c] + tamanho[c]; i++) {
+                if (data[i] < '0' || data[i] > '9') return -1;
+                campos[c] = campos[c] * 10 + (data[i] - '0');
+            }
+        }
+        if (campos[0] < 1 || campos[0] > 31 || campos[1] < 1 || campos[1] > 12) return -1;
+        return campos[2] * 372 + (campos[1] - 1) * 31 + (campos[0] - 1);
+    }
+
+    // Inverso de diaDaData.
+    static string dataDoDia(long long dia) {
+        char texto[16];
+        snprintf(texto, sizeof(texto), "%02d-%02d-%04d",
+                 (int)(dia % 31) + 1, (int)(dia / 31 % 12) + 1, (int)(dia / 372));
+        return texto;
+    }
+
+    void escreverNumero(uint64_t valor) {
+        while (valor >= 0x80) {
+            dados.push_back((uint8_t)(valor | 0x80));
+            valor >>= 7;
+        }
+        dados.push_back((uint8_t)valor);
+    }
+
+    uint64_t lerNumero(size_t& pos) const {
+        uint64_t valor = 0;
+        for (int deslocado = 0; ; deslocado += 7) {
+            uint8_t byte = dados[pos++];
+            valor |= (uint64_t)(byte & 0x7f) << deslocado;
+            if (!(byte & 0x80)) return valor;
+        }
+    }
+
+    // Diferenças com sinal viram números sem sinal pequenos (zigue-zague).
+    void escreverDiferenca(long long diferenca) {
+        escreverNumero(((uint64_t)diferenca << 1) ^ (uint64_t)(diferenca >> 63));
+    }
+
+    long long lerDiferenca(size_t& pos) const {
+        uint64_t valor = lerNumero(pos);
+        return (long long)(valor >> 1) ^ -(long long)(valor & 1);
+    }
+
+    // Grava o texto como prefixo comum com o anterior seguido do sufixo.
+    void escreverTexto(const string& texto, const string& anterior) {
+        size_t comum = 0;
+        while (comum < texto.size() && comum < anterior.size() && texto[comum] == anterior[comum]) {
+            comum++;
+        }
+        escreverNumero(comum);
+        escreverNumero(texto.size() - comum);
+        dados.insert(dados.end(), texto.begin() + comum, texto.end());
+    }
+
+    // Reconstrói o texto sobre o valor anterior, que já está na variável.
+    void lerTexto(size_t& pos, string& texto) const {
+        size_t comum = lerNumero(pos);
+        size_t sufixo = lerNumero(pos);
+        texto.resize(comum);
+        texto.append((const char*)dados.data() + pos, sufixo);
+        pos += sufixo;
+    }
+
+    // Formato de um registro: marcador (1 se as datas vão como texto), ISBN e usuário
+    // codificados por prefixo, e as datas. A data de empréstimo é a diferença para a
+    // do registro anterior e a de devolução é a diferença para a de empréstimo.
+    void codificar(const Emprestimo& emprestimo, const Emprestimo* anterior) {
+        static const string vazio;
+        long long diaEmprestimo = diaDaData(emprestimo.dataEmprestimo);
+        long long diaDevolucao = diaDaData(emprestimo.dataDevolucao);
+        long long diaAnterior = anterior ? diaDaData(anterior->dataEmprestimo) : 0;
+        bool datasEmTexto = diaEmprestimo < 0 || diaDevolucao < 0 || diaAnterior < 0;
+
+        escreverNumero(datasEmTexto ? 1 : 0);
+        escreverTexto(emprestimo.tituloLivro, anterior ? anterior->tituloLivro : vazio);
+        escreverTexto(emprestimo.idUsuario, anterior ? anterior->idUsuario : vazio);
+        if (datasEmTexto) {
+            escreverTexto(emprestimo.dataEmprestimo, vazio);
+            escreverTexto(emprestimo.dataDevolucao, vazio);
+        } else {
+            escreverDiferenca(diaEmprestimo - diaAnterior);
+            escreverDiferenca(diaDevolucao - diaEmprestimo);
+        }
+    }
+
+    // Lê o próximo registro. atual deve conter o registro anterior do mesmo bloco
+    // (ou estar vazio no início do bloco).
+    void decodificar(size_t& pos, Emprestimo& atual) const {
+        bool datasEmTexto = lerNumero(pos) == 1;
+        long long diaAnterior = atual.dataEmprestimo.empty() ? 0 : diaDaData(atual.dataEmprestimo);
+
+        lerTexto(pos, atual.tituloLivro);
+        lerTexto(pos, atual.idUsuario);
+        if (datasEmTexto) {
+            atual.dataEmprestimo.clear();
+            atual.dataDevolucao.clear();
+            lerTexto(pos, atual.dataEmprestimo);
+            lerTexto(pos, atual.dataDevolucao);
+        } else {
+            long long diaEmprestimo = diaAnterior + lerDiferenca(pos);
+            atual.dataEmprestimo = dataDoDia(diaEmprestimo);
+            atual.dataDevolucao = dataDoDia(diaEmprestimo + lerDiferenca(pos));
+        }
+    }
+};
+
+// Camada de arquivo para empréstimos devolvidos ou encerrados. Os empréstimos chegam
+// em um buffer pequeno e, quando ele enche, viram um segmento imutável comprimido.
+// Segmentos vizinhos de tamanho parecido são fundidos, o que mantém poucos segmentos
+// para consultar. O histórico continua consultável por ISBN e por varredura.
+class ArquivoEmprestimos {
+public:
+    static const size_t LIMITE_PENDENTES = 1024;
+
+    // Arquiva um empréstimo.
+    void arquivar(const Emprestimo& emprestimo) {
+        pendentes.push_back(emprestimo);
+        if (pendentes.size() >= LIMITE_PENDENTES) {
+            consolidar();
+        }
+    }
+
+    // Arquiva vários empréstimos.
+    void arquivar(const vector<Emprestimo>& lote) {
+        for (const auto& emprestimo : lote) {
+            arquivar(emprestimo);
+        }
+    }
+
+    // Transforma os pendentes em um segmento comprimido.
+    void consolidar() {
+        if (pendentes.empty()) return;
+        stable_sort(pendentes.begin(), pendentes.end(), [](const Emprestimo& a, const Emprestimo& b) {
+            return a.tituloLivro < b.tituloLivro;
+        });
+        segmentos.push_back(SegmentoArquivo(pendentes));
+        pendentes.clear();
+
+        // Funde o último segmento com o anterior enquanto tiverem tamanhos parecidos.
+        while (segmentos.size() >= 2 &&
+               segmentos[segmentos.size() - 2].tamanho() <= 2 * segmentos.back().tamanho()) {
+            vector<Emprestimo> fundidos;
+            fundidos.reserve(segmentos[segmentos.size() - 2].tamanho() + segmentos.back().tamanho());
+            segmentos[segmentos.size() - 2].percorrer([&](const Emprestimo& e) { fundidos.push_back(e); });
+            size_t meio = fundidos.size();
+            segmentos.back().percorrer([&](const Emprestimo& e) { fundidos.push_back(e); });
+            inplace_merge(fundidos.begin(), fundidos.begin() + meio, fundidos.end(), [](const Emprestimo& a, const Emprestimo& b) {
+                return a.tituloLivro < b.tituloLivro;
+            });
+            segmentos.pop_back();
+            segmentos.back() = SegmentoArquivo(fundidos);
+        }
+    }
+
+    // Acrescenta a resultado todo o histórico do ISBN. Retorna quantos achou.
+    size_t buscar(const string& isbn, vector<Emprestimo>& resultado) const {
+        size_t achados = 0;
+        for (const auto& segmento : segmentos) {
+            achados += segmento.buscar(isbn, resultado);
+        }
+        for (const auto& emprestimo : pendentes) {
+            if (emprestimo.tituloLivro == isbn) {
+                resultado.push_back(emprestimo);
+                achados++;
+            }
+        }
+        return achados;
+    }
+
+    // Remove do histórico os empréstimos que satisfazem o predicado, por exemplo os
+    // devolvidos antes de uma data. Segmentos são imutáveis, então cada segmento com
+    // algum empréstimo removido é regravado só com os que ficam; os demais não são
+    // tocados. Retorna quantos foram removidos.
+    template <typename Predicado>
+    size_t expurgar(Predicado predicado) {
+        size_t removidos = 0;
+        vector<SegmentoArquivo> restantes;
+        restantes.reserve(segmentos.size());
+        for (auto& segmento : segmentos) {
+            vector<Emprestimo> mantidos;
+            segmento.percorrer([&](const Emprestimo& e) {
+                if (!predicado(e)) mantidos.push_back(e);
+            });
+            if (mantidos.size() == segmento.tamanho()) {
+                restantes.push_back(move(segmento));
+            } else {
+                removidos += segmento.tamanho() - mantidos.size();
+                if (!mantidos.empty()) restantes.push_back(SegmentoArquivo(mantidos));
+            }
+        }
+        segmentos = move(restantes);
+
+        auto fim = remove_if(pendentes.begin(), pendentes.end(), predicado);
+        removidos += pendentes.end() - fim;
+        pendentes.erase(fim, pendentes.end());
+        return removidos;
+    }
+
+    // Chama visitar para cada empréstimo arquivado. A ordem é por chave dentro de
+    // cada segmento, mas não entre segmentos.
+    template <typename Visitante>
+    void percorrer(Visitante visitar) const {
+        for (const auto& segmento : segmentos) {
+            segmento.percorrer(visitar);
+        }
+        for (const auto& emprestimo : pendentes) {
+            visitar(emprestimo);
+        }
+    }
+
+    // Número de empréstimos arquivados.
+    size_t tamanho() const {
+        size_t soma = pendentes.size();
+        for (const auto& segmento : segmentos) {
+            soma += segmento.tamanho();
+        }
+        return soma;
+    }
+
+    // Memória ocupada pelos segmentos comprimidos.
+    size_t bytesComprimidos() const {
+        size_t soma = 0;
+        for (const auto& segmento : segmentos) {
+            soma += segmento.bytes();
+        }
+        return soma;
+    }
+
+private:
+    vector<SegmentoArquivo> segmentos;  // Segmentos imutáveis, do mais antigo ao mais novo.
+    vector<Emprestimo> pendentes;       // Empréstimos ainda não comprimidos.
+};
+
+#endif // ARQUIVO_EMPRESTIMOS_H
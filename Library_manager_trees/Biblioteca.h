@@ -0,0 +1,488 @@
+#ifndef BIBLIOTECA_H
+#define BIBLIOTECA_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include "Livro.h"
+#include "Usuario.h"
+#include "Emprestimo.h"
+#include "Transacao.h"
+#include "CatalogoColunar.h"
+#include "CatalogoCongelado.h"
+#include "ArquivoEmprestimos.h"
+#include "Trace.h"
+#include "Compactacao.h"
+#include "Relatorio.h"
+
+using namespace std;
+
+// Converte uma data "dd-mm-aaaa" em time_t (meia-noite UTC). O dia é calculado
+// diretamente do calendário, sem mktime, que consulta o fuso horário global e não
+// pode ser chamado de várias threads ao mesmo tempo.
+inline time_t converterData(const string& data) {
+    tm tmData = {};
+    istringstream ssData(data);
+    ssData >> get_time(&tmData, "%d-%m-%Y");
+
+    long long ano = tmData.tm_year + 1900, mes = tmData.tm_mon + 1;
+    if (mes <= 2) ano--;
+    long long era = (ano >= 0 ? ano : ano - 399) / 400;
+    long long anoDaEra = ano - era * 400;
+    long long diaDoAno = (153 * (mes > 2 ? mes - 3 : mes + 9) + 2) / 5 + tmData.tm_mday - 1;
+    long long diaDaEra = anoDaEra * 365 + anoDaEra / 4 - anoDaEra / 100 + diaDoAno;
+    return (time_t)((era * 146097 + diaDaEra - 719468) * 86400);
+}
+
+// Resumo do catálogo para a tela de estatísticas.
+struct EstatisticasCatalogo {
+    size_t livros = 0;
+    long long totalPaginas = 0;
+    int menorPaginas = 0, maiorPaginas = 0;
+    vector<size_t> histograma;      // Livros por faixa de páginas.
+    vector<string> autores;         // Todos os autores com livros, do que tem mais para o que tem menos.
+    vector<size_t> livrosAutor;     // Livros de cada autor, na ordem de autores.
+    vector<long long> paginasAutor; // Páginas de cada autor, na ordem de autores.
+};
+
+// Contagens e assinatura do conteúdo de uma biblioteca, gravadas no fim do trace para
+// que a reprodução confira se chegou ao mesmo estado. A assinatura soma o hash de
+// cada livro, usuário e empréstimo ativo, e por isso não depende da ordem em que os
+// registros são visitados.
+struct ResumoEstado {
+    size_t livros = 0, usuarios = 0, emprestimos = 0, arquivados = 0;
+    uint64_t assinatura = 0;
+
+    // Acumula o resumo de outra parte do acervo. Como a assinatura é uma soma, o total
+    // de vários fragmentos é igual ao de uma biblioteca única com o mesmo conteúdo.
+    void somar(const ResumoEstado& outro) {
+        livros += outro.livros;
+        usuarios += outro.usuarios;
+        emprestimos += outro.emprestimos;
+        arquivados += outro.arquivados;
+        assinatura += outro.assinatura;
+    }
+
+    vector<string> argumentos() const {
+        ostringstream hexa;
+        hexa << hex << setw(16) << setfill('0') << assinatura;
+        return {to_string(livros), to_string(usuarios), to_string(emprestimos), to_string(arquivados), hexa.str()};
+    }
+};
+
+// FNV-1a de 64 bits sobre os campos de um registro, cada um seguido de um zero.
+inline uint64_t hashCampos(initializer_list<const string*> campos) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const string* campo : campos) {
+        for (unsigned char c : *campo) {
+            h = (h ^ c) * 1099511628211ULL;
+        }
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Reúne as três árvores e as estruturas mantidas junto com elas, e expõe as operações
+// do menu sem nenhuma entrada ou saída de console. Todas as operações obtêm a trava da
+// biblioteca, e cada uma é registrada no trace quando há um gravador associado, o que
+// permite reproduzir a carga de um dia inteiro sem passar pelo menu. O registro é feito
+// dentro da seção crítica da operação, para que a ordem do trace seja a ordem em que as
+// operações de fato alteraram a biblioteca.
+class Biblioteca {
+    // Usa as partes privadas que esperam a trava já obtida, para travar vários
+    // fragmentos de uma vez ou consultá-los sem registrar cada um no trace.
+    friend class BibliotecaFragmentada;
+
+public:
+    BST livros;                    // Catálogo de livros por ISBN.
+    AVL usuarios;                  // Usuários por ID.
+    BTree emprestimos;             // Empréstimos ativos por ISBN.
+    IndiceLivros indiceLivros;     // Índice hash ligado à BST.
+    IndiceUsuarios indiceUsuarios; // Índice hash ligado à AVL.
+    CatalogoCongelado livrosCongelados; // Cópia somente leitura da BST para as buscas.
+    CatalogoColunar catalogo;      // Colunas do catálogo para estatísticas.
+    ArquivoEmprestimos historico;  // Empréstimos devolvidos, com a data real de devolução, comprimidos.
+    mutex trava;                   // Protege todas as estruturas acima.
+    GravadorTrace* gravador;       // Destino do trace, ou nulo se não estiver gravando.
+
+    Biblioteca() : gravador(nullptr) {
+        livros.attachIndex(&indiceLivros);
+        livros.attachFrozen(&livrosCongelados);
+        usuarios.attachIndex(&indiceUsuarios);
+    }
+
+    // As árvores apontam para os índices deste objeto; uma cópia apontaria para os do original.
+    Biblioteca(const Biblioteca&) = delete;
+    Biblioteca& operator=(const Biblioteca&) = delete;
+
+    // Cadastra o livro. ISBNs repetidos são ignorados, como na BST. Retorna false, sem
+    // cadastrar, se o número de páginas não for positivo: as colunas do catálogo e o
+    // histograma de páginas contam só com valores positivos.
+    bool cadastrarLivro(const Livro& livro) {
+        if (livro.numeroPaginas <= 0) return false;
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_CADASTRAR_LIVRO, {livro.ISBN, livro.titulo, livro.autor, to_string(livro.numeroPaginas)});
+        livros.root = livros.insert(livros.root, livro);
+        catalogo.adicionar(livro);
+        return true;
+    }
+
+    // Remove o livro. Retorna false se não existir.
+    bool removerLivro(const string& isbn) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_REMOVER_LIVRO, {isbn});
+        if (!livros.lookup(isbn)) return false;
+        livros.root = livros.remove(livros.root, isbn);
+        catalogo.remover(isbn);
+        return true;
+    }
+
+    // Copia o livro para resultado, se existir.
+    bool buscarLivro(const string& isbn, Livro& resultado) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_BUSCAR_LIVRO, {isbn});
+        Livro* livro = livros.lookup(isbn);
+        if (!livro) return false;
+        resultado = *livro;
+        return true;
+    }
+
+    // Cadastra o usuário. IDs repetidos são ignorados, como na AVL.
+    void cadastrarUsuario(const Usuario& usuario) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_CADASTRAR_USUARIO, {usuario.id, usuario.nome, usuario.contato});
+        usuarios.root = usuarios.insert(usuarios.root, usuario);
+    }
+
+    // Remove o usuário. Retorna false se não existir.
+    bool removerUsuario(const string& id) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_REMOVER_USUARIO, {id});
+        if (!usuarios.lookup(id)) return false;
+        usuarios.root = usuarios.remove(usuarios.root, id);
+        return true;
+    }
+
+    // Copia o usuário para resultado, se existir.
+    bool buscarUsuario(const string& id, Usuario& resultado) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_BUSCAR_USUARIO, {id});
+        Usuario* usuario = usuarios.lookup(id);
+        if (!usuario) return false;
+        resultado = *usuario;
+        return true;
+    }
+
+    // Empresta todos os livros ao usuário em uma única transação. Em caso de falha,
+    // nada é gravado e falha recebe o ISBN responsável, quando houver um.
+    ResultadoTransacao registrarEmprestimo(const string& idUsuario, const string& dataEmprestimo,
+                                           const string& dataDevolucao, const vector<string>& isbns,
+                                           string& falha) {
+        vector<string> argumentos = {idUsuario, dataEmprestimo, dataDevolucao};
+        argumentos.insert(argumentos.end(), isbns.begin(), isbns.end());
+
+        TransacaoEmprestimo transacao(livros, usuarios, emprestimos, trava, idUsuario, dataEmprestimo, dataDevolucao);
+        for (const auto& isbn : isbns) {
+            transacao.adicionar(isbn);
+        }
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_REGISTRAR_EMPRESTIMO, argumentos);
+        ResultadoTransacao resultado = transacao.confirmarComTrava();
+        falha = transacao.itemComFalha();
+        return resultado;
+    }
+
+    // Devolve o livro na data informada (dd-mm-aaaa) e arquiva o empréstimo com essa
+    // data. Retorna false se o livro não existir.
+    bool devolverLivro(const string& isbn, const string& data) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_DEVOLVER_LIVRO, {isbn, data});
+        if (!livros.lookup(isbn)) return false;
+        size_t antes = emprestimos.size();
+        Emprestimo devolvido;
+        emprestimos.root = emprestimos.remove(emprestimos.root, isbn, &devolvido);
+        if (emprestimos.size() != antes) {
+            arquivarDevolucao(move(devolvido), data);
+        }
+        return true;
+    }
+
+    // Devolve vários livros de uma vez na data informada. Retorna quantos empréstimos
+    // foram encerrados.
+    size_t devolverLivros(const vector<string>& isbns, const string& data) {
+        vector<string> argumentos = {data};
+        argumentos.insert(argumentos.end(), isbns.begin(), isbns.end());
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_DEVOLVER_LOTE, argumentos);
+        return devolverComTrava(isbns, data);
+    }
+
+    // Remove do histórico os empréstimos devolvidos antes da data (dd-mm-aaaa). Os
+    // empréstimos ativos continuam na árvore até serem devolvidos, mesmo atrasados.
+    size_t expurgarHistorico(const string& data) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_EXPURGAR_HISTORICO, {data});
+        return expurgarComTrava(data);
+    }
+
+    // Página de uma listagem: até limite livros, em ordem de ISBN, a partir do primeiro
+    // ISBN maior ou igual a inicio. A trava só é mantida durante a página, de modo que
+    // a listagem pode ser retomada depois com a chave seguinte à última recebida.
+    vector<Livro> listarLivros(const string& inicio, size_t limite, bool somenteDisponiveis) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_LISTAR_LIVROS, {inicio, to_string(limite), somenteDisponiveis ? "1" : "0"});
+        return paginaLivros(inicio, limite, somenteDisponiveis);
+    }
+
+    // Página de usuários em ordem de ID, como listarLivros.
+    vector<Usuario> listarUsuarios(const string& inicio, size_t limite) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_LISTAR_USUARIOS, {inicio, to_string(limite)});
+        return paginaUsuarios(inicio, limite);
+    }
+
+    // Página de empréstimos ativos em ordem de ISBN, como listarLivros.
+    vector<Emprestimo> listarEmprestimos(const string& inicio, size_t limite) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_LISTAR_EMPRESTIMOS, {inicio, to_string(limite)});
+        return paginaEmprestimos(inicio, limite);
+    }
+
+    // Escreve no relatório todos os livros (tipo 1), usuários (2) ou empréstimos (3).
+    // Os registros são lidos em páginas, sem manter a trava durante a escrita.
+    // Retorna quantos registros foram escritos.
+    size_t exportarRelatorio(int tipo, Relatorio& relatorio) {
+        vector<string> argumentos = {to_string(tipo)};
+        if (tipo == 1) {
+            return exportar<Livro, BSTIterator>(livros.root, relatorio, argumentos,
+                                                [](const Livro& livro) { return livro.ISBN; });
+        } else if (tipo == 2) {
+            return exportar<Usuario, AVLIterator>(usuarios.root, relatorio, argumentos,
+                                                  [](const Usuario& usuario) { return usuario.id; });
+        }
+        return exportar<Emprestimo, BTreeIterator>(emprestimos.root, relatorio, argumentos,
+                                                   [](const Emprestimo& emprestimo) { return emprestimo.tituloLivro; });
+    }
+
+    // Calcula as estatísticas do catálogo a partir das colunas, com faixas de páginas
+    // da largura dada. Largura ou número de faixas não positivos dão o resultado vazio.
+    EstatisticasCatalogo estatisticas(int largura, int faixas) {
+        if (largura <= 0 || faixas <= 0) return EstatisticasCatalogo();
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_ESTATISTICAS, {to_string(largura), to_string(faixas)});
+        return estatisticasComTrava(largura, faixas);
+    }
+
+    // Acrescenta a encontrados os empréstimos arquivados do livro.
+    void consultarHistorico(const string& isbn, vector<Emprestimo>& encontrados) {
+        lock_guard<mutex> guarda(trava);
+        anotar(OP_CONSULTAR_HISTORICO, {isbn});
+        historico.buscar(isbn, encontrados);
+    }
+
+    // Número de empréstimos arquivados e bytes que ocupam comprimidos.
+    void tamanhoHistorico(size_t& registros, size_t& bytes) {
+        lock_guard<mutex> guarda(trava);
+        registros = historico.tamanho();
+        bytes = historico.bytesComprimidos();
+    }
+
+    // Compacta as três árvores e devolve as métricas de cada uma (livros, usuários e
+    // empréstimos, nesta ordem) antes e depois. A reconstrução é feita fora da trava,
+    // que só é obtida para copiar os registros em etapas e trocar as raízes; a árvore
+    // que mudar no meio é copiada de novo, e depois de TENTATIVAS_COMPACTACAO
+    // tentativas é reconstruída com a trava mantida do início ao fim.
+    vector<pair<MetricasArvore, MetricasArvore>> compactar() {
+        {
+            // A compactação não muda o conteúdo; a trava só situa o registro entre as
+            // operações que terminaram antes e as que começam depois.
+            lock_guard<mutex> guarda(trava);
+            anotar(OP_COMPACTAR, {});
+        }
+        return compactarArvores();
+    }
+
+    // Contagens e assinatura do estado atual.
+    ResumoEstado resumo() {
+        lock_guard<mutex> guarda(trava);
+        return resumoComTrava();
+    }
+
+    // Grava no trace o resumo do estado atual, que a reprodução compara com o seu.
+    void registrarEstadoFinal() {
+        lock_guard<mutex> guarda(trava);
+        if (gravador) anotar(OP_ESTADO_FINAL, resumoComTrava().argumentos());
+    }
+
+    // Indicam se o livro ou o usuário está cadastrado. Servem para validar a entrada
+    // do menu antes da operação e por isso não são registradas no trace.
+    bool livroCadastrado(const string& isbn) {
+        lock_guard<mutex> guarda(trava);
+        return livros.lookup(isbn) != nullptr;
+    }
+
+    bool usuarioCadastrado(const string& id) {
+        lock_guard<mutex> guarda(trava);
+        return usuarios.lookup(id) != nullptr;
+    }
+
+private:
+    static const int TENTATIVAS_COMPACTACAO = 3;
+    static const size_t TAMANHO_LOTE_EXPORTACAO = 1024;
+
+    // As três árvores compactadas uma após a outra, como em compactar(), sem registrar
+    // no trace. Obtém a trava por conta própria.
+    vector<pair<MetricasArvore, MetricasArvore>> compactarArvores() {
+        vector<pair<MetricasArvore, MetricasArvore>> metricas(3);
+        compactarArvore(livros, metricas[0]);
+        compactarArvore(usuarios, metricas[1]);
+        compactarArvore(emprestimos, metricas[2]);
+        return metricas;
+    }
+
+    // As funções a seguir, até resumoComTrava, são chamadas com a trava obtida e não
+    // registram nada no trace.
+
+    // Indica se o livro está emprestado.
+    bool livroEmprestado(const string& isbn) {
+        return emprestimos.search(emprestimos.root, isbn) != nullptr;
+    }
+
+    size_t devolverComTrava(const vector<string>& isbns, const string& data) {
+        vector<Emprestimo> devolvidos;
+        size_t quantidade = emprestimos.removeBatch(isbns, &devolvidos);
+        for (auto& emprestimo : devolvidos) {
+            arquivarDevolucao(move(emprestimo), data);
+        }
+        return quantidade;
+    }
+
+    size_t expurgarComTrava(const string& data) {
+        time_t limite = converterData(data);
+        return historico.expurgar([limite](const Emprestimo& emprestimo) {
+            return difftime(limite, converterData(emprestimo.dataDevolucao)) > 0;
+        });
+    }
+
+    vector<Livro> paginaLivros(const string& inicio, size_t limite, bool somenteDisponiveis) {
+        return pagina<Livro, BSTIterator>(livros.root, inicio, limite, [&](const Livro& livro) {
+            return !somenteDisponiveis || !livroEmprestado(livro.ISBN);
+        });
+    }
+
+    vector<Usuario> paginaUsuarios(const string& inicio, size_t limite) {
+        return pagina<Usuario, AVLIterator>(usuarios.root, inicio, limite, [](const Usuario&) { return true; });
+    }
+
+    vector<Emprestimo> paginaEmprestimos(const string& inicio, size_t limite) {
+        return pagina<Emprestimo, BTreeIterator>(emprestimos.root, inicio, limite, [](const Emprestimo&) { return true; });
+    }
+
+    EstatisticasCatalogo estatisticasComTrava(int largura, int faixas) {
+        EstatisticasCatalogo resultado;
+        if (!catalogo.minMaxPaginas(resultado.menorPaginas, resultado.maiorPaginas)) return resultado;
+        resultado.livros = catalogo.tamanho();
+        resultado.totalPaginas = catalogo.somaPaginas();
+        resultado.histograma = catalogo.histogramaPaginas(largura, faixas);
+
+        vector<size_t> livrosAutor = catalogo.livrosPorAutor();
+        vector<long long> paginasAutor = catalogo.paginasPorAutor();
+        vector<size_t> ordem;
+        for (size_t i = 0; i < livrosAutor.size(); i++) {
+            if (livrosAutor[i] > 0) ordem.push_back(i);
+        }
+        stable_sort(ordem.begin(), ordem.end(), [&](size_t a, size_t b) { return livrosAutor[a] > livrosAutor[b]; });
+        for (size_t i : ordem) {
+            resultado.autores.push_back(catalogo.autores[i]);
+            resultado.livrosAutor.push_back(livrosAutor[i]);
+            resultado.paginasAutor.push_back(paginasAutor[i]);
+        }
+        return resultado;
+    }
+
+    // Contagens e assinatura do estado atual.
+    ResumoEstado resumoComTrava() {
+        ResumoEstado r;
+        for (BSTIterator it(livros.root); it.valido(); it.avancar(), r.livros++) {
+            const Livro& l = it.atual();
+            string paginas = to_string(l.numeroPaginas);
+            r.assinatura += hashCampos({&l.ISBN, &l.titulo, &l.autor, &paginas});
+        }
+        for (AVLIterator it(usuarios.root); it.valido(); it.avancar(), r.usuarios++) {
+            const Usuario& u = it.atual();
+            r.assinatura += hashCampos({&u.id, &u.nome, &u.contato});
+        }
+        for (BTreeIterator it(emprestimos.root); it.valido(); it.avancar(), r.emprestimos++) {
+            const Emprestimo& e = it.atual();
+            r.assinatura += hashCampos({&e.tituloLivro, &e.idUsuario, &e.dataEmprestimo, &e.dataDevolucao});
+        }
+        r.arquivados = historico.tamanho();
+        return r;
+    }
+
+    // Menor chave maior que a dada, para retomar uma listagem depois dela.
+    static string chaveSeguinte(const string& chave) {
+        return chave + '\0';
+    }
+
+    // Até limite registros da árvore, a partir da chave inicio, que passam pelo filtro.
+    // Chamado com a trava obtida.
+    template <typename Valor, typename Iterador, typename No, typename Filtro>
+    vector<Valor> pagina(No* const& raiz, const string& inicio, size_t limite, Filtro filtro) {
+        vector<Valor> resultado;
+        for (Iterador it(raiz, inicio); it.valido() && resultado.size() < limite; it.avancar()) {
+            if (filtro(it.atual())) resultado.push_back(it.atual());
+        }
+        return resultado;
+    }
+
+    // Escreve toda a árvore no relatório, lendo um lote por vez sob a trava e escrevendo
+    // sem ela. A operação é registrada junto com o primeiro lote.
+    template <typename Valor, typename Iterador, typename No, typename Chave>
+    size_t exportar(No* const& raiz, Relatorio& relatorio, const vector<string>& argumentos, Chave chave) {
+        size_t total = 0;
+        string inicio;
+        for (bool primeiro = true;; primeiro = false) {
+            vector<Valor> lote;
+            {
+                lock_guard<mutex> guarda(trava);
+                if (primeiro) anotar(OP_EXPORTAR_RELATORIO, argumentos);
+                lote = pagina<Valor, Iterador>(raiz, inicio, TAMANHO_LOTE_EXPORTACAO, [](const Valor&) { return true; });
+            }
+            for (const auto& registro : lote) relatorio.registro(registro);
+            total += lote.size();
+            if (lote.size() < TAMANHO_LOTE_EXPORTACAO) return total;
+            inicio = chaveSeguinte(chave(lote.back()));
+        }
+    }
+
+    template <typename Arvore>
+    void compactarArvore(Arvore& arvore, pair<MetricasArvore, MetricasArvore>& metricas) {
+        for (int tentativa = 0; tentativa < TENTATIVAS_COMPACTACAO; tentativa++) {
+            if (::compactar(arvore, trava, metricas.first, metricas.second)) return;
+        }
+        lock_guard<mutex> guarda(trava);
+        metricas.first = medir(arvore);
+        ::compactar(arvore);
+        metricas.second = medir(arvore);
+    }
+
+    // Move um empréstimo encerrado para o histórico, registrando quando foi devolvido.
+    void arquivarDevolucao(Emprestimo emprestimo, const string& data) {
+        emprestimo.dataDevolucao = data;
+        historico.arquivar(emprestimo);
+    }
+
+    // Registra a operação no trace. Chamado com a trava obtida.
+    void anotar(TipoOperacao tipo, const vector<string>& argumentos) {
+        if (gravador) gravador->registrar(tipo, argumentos);
+    }
+};
+
+#endif // BIBLIOTECA_H
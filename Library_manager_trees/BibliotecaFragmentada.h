@@ -0,0 +1,433 @@
+#ifndef BIBLIOTECA_FRAGMENTADA_H
+#define BIBLIOTECA_FRAGMENTADA_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <map>
+#include "Biblioteca.h"
+#include "PoolTarefas.h"
+
+using namespace std;
+
+// Intercala listas já ordenadas em uma única lista ordenada (k-way merge com heap).
+template <typename V, typename Menor>
+vector<V> intercalar(vector<vector<V>>& listas, Menor menor) {
+    typedef pair<size_t, size_t> Posicao;  // Lista e índice dentro dela.
+    auto maior = [&](const Posicao& a, const Posicao& b) {
+        return menor(listas[b.first][b.second], listas[a.first][a.second]);
+    };
+    priority_queue<Posicao, vector<Posicao>, decltype(maior)> fila(maior);
+
+    size_t total = 0;
+    for (size_t l = 0; l < listas.size(); l++) {
+        total += listas[l].size();
+        if (!listas[l].empty()) fila.push(Posicao(l, 0));
+    }
+
+    vector<V> resultado;
+    resultado.reserve(total);
+    while (!fila.empty()) {
+        Posicao p = fila.top();
+        fila.pop();
+        resultado.push_back(move(listas[p.first][p.second]));
+        if (p.second + 1 < listas[p.first].size()) fila.push(Posicao(p.first, p.second + 1));
+    }
+    return resultado;
+}
+
+// Várias bibliotecas independentes (fragmentos), cada uma com suas árvores, arenas,
+// índices, histórico e trava, vistas como um único acervo. Livros e empréstimos vão
+// para o fragmento do ISBN e usuários para o do ID, escolhidos pelo hash da chave;
+// assim o livro e seu empréstimo ficam sempre juntos. Operações sobre uma chave tocam
+// um só fragmento e só disputam a trava dele; consultas sobre o acervo inteiro rodam
+// em paralelo em todos os fragmentos e os resultados, já ordenados em cada um, são
+// intercalados.
+// O trace recebe os mesmos tipos e argumentos de Biblioteca, de modo que um trace pode
+// ser reproduzido com qualquer número de fragmentos. As operações sobre uma chave são
+// registradas pelo próprio fragmento, dentro da sua seção crítica; as que alteram
+// vários fragmentos são registradas com as travas de todos eles obtidas. As consultas
+// sobre o acervo inteiro não alteram nada e são registradas antes de começar.
+class BibliotecaFragmentada {
+public:
+    // O fragmento 0 de cada consulta roda na thread que chamou; os demais, no pool,
+    // que tem uma thread para cada um deles. Com gravador, todas as operações vão para
+    // o trace.
+    explicit BibliotecaFragmentada(size_t numFragmentos, GravadorTrace* destino = nullptr)
+        : gravador(destino), pool(numFragmentos > 1 ? numFragmentos - 1 : 0) {
+        if (numFragmentos == 0) numFragmentos = 1;
+        for (size_t i = 0; i < numFragmentos; i++) {
+            fragmentos.emplace_back(new Biblioteca());
+            fragmentos.back()->gravador = destino;
+        }
+    }
+
+    BibliotecaFragmentada(const BibliotecaFragmentada&) = delete;
+    BibliotecaFragmentada& operator=(const BibliotecaFragmentada&) = delete;
+
+    size_t tamanho() const {
+        return fragmentos.size();
+    }
+
+    // Fragmento responsável pela chave (ISBN ou ID de usuário).
+    size_t fragmentoDe(const string& chave) const {
+        return hash<string>()(chave) % fragmentos.size();
+    }
+
+    bool cadastrarLivro(const Livro& livro) {
+        return fragmentos[fragmentoDe(livro.ISBN)]->cadastrarLivro(livro);
+    }
+
+    bool removerLivro(const string& isbn) {
+        return fragmentos[fragmentoDe(isbn)]->removerLivro(isbn);
+    }
+
+    bool buscarLivro(const string& isbn, Livro& resultado) {
+        return fragmentos[fragmentoDe(isbn)]->buscarLivro(isbn, resultado);
+    }
+
+    void cadastrarUsuario(const Usuario& usuario) {
+        fragmentos[fragmentoDe(usuario.id)]->cadastrarUsuario(usuario);
+    }
+
+    bool removerUsuario(const string& id) {
+        return fragmentos[fragmentoDe(id)]->removerUsuario(id);
+    }
+
+    bool buscarUsuario(const string& id, Usuario& resultado) {
+        return fragmentos[fragmentoDe(id)]->buscarUsuario(id, resultado);
+    }
+
+    bool livroCadastrado(const string& isbn) {
+        return fragmentos[fragmentoDe(isbn)]->livroCadastrado(isbn);
+    }
+
+    bool usuarioCadastrado(const string& id) {
+        return fragmentos[fragmentoDe(id)]->usuarioCadastrado(id);
+    }
+
+    // Empresta todos os livros ao usuário, ou nenhum, com as mesmas regras de
+    // TransacaoEmprestimo (validarCarrinho). As travas do fragmento do usuário e dos
+    // fragmentos dos livros são mantidas da validação até a gravação.
+    ResultadoTransacao registrarEmprestimo(const string& idUsuario, const string& dataEmprestimo,
+                                           const string& dataDevolucao, const vector<string>& isbns,
+                                           string& falha) {
+        vector<string> argumentos = {idUsuario, dataEmprestimo, dataDevolucao};
+        argumentos.insert(argumentos.end(), isbns.begin(), isbns.end());
+
+        size_t fragmentoUsuario = fragmentoDe(idUsuario);
+        vector<vector<Emprestimo>> lotes(fragmentos.size());
+        vector<bool> envolvidos(fragmentos.size(), false);
+        envolvidos[fragmentoUsuario] = true;
+        for (const auto& isbn : isbns) {
+            size_t f = fragmentoDe(isbn);
+            lotes[f].emplace_back(isbn, idUsuario, dataEmprestimo, dataDevolucao);
+            envolvidos[f] = true;
+        }
+
+        vector<unique_lock<mutex>> guardas = travar(envolvidos);
+        anotar(OP_REGISTRAR_EMPRESTIMO, argumentos);
+        falha.clear();
+        ResultadoTransacao resultado = validarCarrinho(isbns, idUsuario,
+            [&](const string& id) { return fragmentos[fragmentoUsuario]->usuarios.lookup(id) != nullptr; },
+            [&](const string& isbn) { return fragmentos[fragmentoDe(isbn)]->livros.lookup(isbn) != nullptr; },
+            [&](const string& isbn) { return fragmentos[fragmentoDe(isbn)]->livroEmprestado(isbn); },
+            falha);
+        if (resultado != TRANSACAO_CONFIRMADA) return resultado;
+
+        for (size_t f = 0; f < fragmentos.size(); f++) {
+            if (!lotes[f].empty()) fragmentos[f]->emprestimos.insertBatch(move(lotes[f]));
+        }
+        return TRANSACAO_CONFIRMADA;
+    }
+
+    bool devolverLivro(const string& isbn, const string& data) {
+        return fragmentos[fragmentoDe(isbn)]->devolverLivro(isbn, data);
+    }
+
+    // Separa os ISBNs por fragmento e devolve cada grupo no seu fragmento, com as travas
+    // de todos os grupos obtidas.
+    size_t devolverLivros(const vector<string>& isbns, const string& data) {
+        vector<string> argumentos = {data};
+        argumentos.insert(argumentos.end(), isbns.begin(), isbns.end());
+        vector<vector<string>> grupos(fragmentos.size());
+        vector<bool> envolvidos(fragmentos.size(), false);
+        for (const auto& isbn : isbns) {
+            size_t f = fragmentoDe(isbn);
+            grupos[f].push_back(isbn);
+            envolvidos[f] = true;
+        }
+
+        vector<unique_lock<mutex>> guardas = travar(envolvidos);
+        anotar(OP_DEVOLVER_LOTE, argumentos);
+        size_t quantidade = 0;
+        for (size_t f = 0; f < fragmentos.size(); f++) {
+            if (!grupos[f].empty()) quantidade += fragmentos[f]->devolverComTrava(grupos[f], data);
+        }
+        return quantidade;
+    }
+
+    // Remove do histórico de todos os fragmentos os empréstimos devolvidos antes da data.
+    size_t expurgarHistorico(const string& data) {
+        vector<unique_lock<mutex>> guardas = travar(vector<bool>(fragmentos.size(), true));
+        anotar(OP_EXPURGAR_HISTORICO, {data});
+        size_t quantidade = 0;
+        for (auto& b : fragmentos) {
+            quantidade += b->expurgarComTrava(data);
+        }
+        return quantidade;
+    }
+
+    // Página de livros em ordem de ISBN, como Biblioteca::listarLivros. Cada fragmento
+    // devolve a sua página a partir de inicio; a intercalação fica com os primeiros.
+    vector<Livro> listarLivros(const string& inicio, size_t limite, bool somenteDisponiveis) {
+        anotar(OP_LISTAR_LIVROS, {inicio, to_string(limite), somenteDisponiveis ? "1" : "0"});
+        return paginaLivros(inicio, limite, somenteDisponiveis);
+    }
+
+    vector<Usuario> listarUsuarios(const string& inicio, size_t limite) {
+        anotar(OP_LISTAR_USUARIOS, {inicio, to_string(limite)});
+        return paginaUsuarios(inicio, limite);
+    }
+
+    vector<Emprestimo> listarEmprestimos(const string& inicio, size_t limite) {
+        anotar(OP_LISTAR_EMPRESTIMOS, {inicio, to_string(limite)});
+        return paginaEmprestimos(inicio, limite);
+    }
+
+    // Empréstimos ativos do usuário, em ordem de ISBN. Como os empréstimos ficam no
+    // fragmento do livro, todos os fragmentos são consultados. Não há operação
+    // correspondente no trace.
+    vector<Emprestimo> emprestimosDoUsuario(const string& idUsuario) {
+        vector<vector<Emprestimo>> parciais = emTodos([&](Biblioteca& b, size_t) {
+            lock_guard<mutex> guarda(b.trava);
+            vector<Emprestimo> emprestimos;
+            for (BTreeIterator it(b.emprestimos.root); it.valido(); it.avancar()) {
+                if (it.atual().idUsuario == idUsuario) emprestimos.push_back(it.atual());
+            }
+            return emprestimos;
+        });
+        return intercalar(parciais, [](const Emprestimo& a, const Emprestimo& b) {
+            return a.tituloLivro < b.tituloLivro;
+        });
+    }
+
+    // Escreve no relatório todos os registros do tipo, em ordem de chave, lendo páginas
+    // intercaladas de todos os fragmentos.
+    size_t exportarRelatorio(int tipo, Relatorio& relatorio) {
+        anotar(OP_EXPORTAR_RELATORIO, {to_string(tipo)});
+        if (tipo == 1) {
+            return exportar([&](const string& inicio) { return paginaLivros(inicio, TAMANHO_LOTE_EXPORTACAO, false); },
+                            relatorio, [](const Livro& livro) { return livro.ISBN; });
+        } else if (tipo == 2) {
+            return exportar([&](const string& inicio) { return paginaUsuarios(inicio, TAMANHO_LOTE_EXPORTACAO); },
+                            relatorio, [](const Usuario& usuario) { return usuario.id; });
+        }
+        return exportar([&](const string& inicio) { return paginaEmprestimos(inicio, TAMANHO_LOTE_EXPORTACAO); },
+                        relatorio, [](const Emprestimo& emprestimo) { return emprestimo.tituloLivro; });
+    }
+
+    // Soma as estatísticas dos fragmentos; autores presentes em vários fragmentos são
+    // reunidos pelo nome.
+    EstatisticasCatalogo estatisticas(int largura, int faixas) {
+        if (largura <= 0 || faixas <= 0) return EstatisticasCatalogo();
+        anotar(OP_ESTATISTICAS, {to_string(largura), to_string(faixas)});
+        vector<EstatisticasCatalogo> parciais = emTodos([&](Biblioteca& b, size_t) {
+            lock_guard<mutex> guarda(b.trava);
+            return b.estatisticasComTrava(largura, faixas);
+        });
+
+        EstatisticasCatalogo resultado;
+        map<string, pair<size_t, long long>> porAutor;
+        for (const auto& parcial : parciais) {
+            if (parcial.livros == 0) continue;
+            if (resultado.livros == 0) {
+                resultado.menorPaginas = parcial.menorPaginas;
+                resultado.maiorPaginas = parcial.maiorPaginas;
+                resultado.histograma.assign(faixas, 0);
+            }
+            resultado.menorPaginas = min(resultado.menorPaginas, parcial.menorPaginas);
+            resultado.maiorPaginas = max(resultado.maiorPaginas, parcial.maiorPaginas);
+            resultado.livros += parcial.livros;
+            resultado.totalPaginas += parcial.totalPaginas;
+            for (int f = 0; f < faixas; f++) resultado.histograma[f] += parcial.histograma[f];
+            for (size_t i = 0; i < parcial.autores.size(); i++) {
+                porAutor[parcial.autores[i]].first += parcial.livrosAutor[i];
+                porAutor[parcial.autores[i]].second += parcial.paginasAutor[i];
+            }
+        }
+
+        typedef pair<string, pair<size_t, long long>> Autor;
+        vector<Autor> autores(porAutor.begin(), porAutor.end());
+        stable_sort(autores.begin(), autores.end(), [](const Autor& a, const Autor& b) {
+            return a.second.first > b.second.first;
+        });
+        for (const auto& autor : autores) {
+            resultado.autores.push_back(autor.first);
+            resultado.livrosAutor.push_back(autor.second.first);
+            resultado.paginasAutor.push_back(autor.second.second);
+        }
+        return resultado;
+    }
+
+    void consultarHistorico(const string& isbn, vector<Emprestimo>& encontrados) {
+        fragmentos[fragmentoDe(isbn)]->consultarHistorico(isbn, encontrados);
+    }
+
+    void tamanhoHistorico(size_t& registros, size_t& bytes) {
+        registros = bytes = 0;
+        for (auto& b : fragmentos) {
+            size_t r, t;
+            b->tamanhoHistorico(r, t);
+            registros += r;
+            bytes += t;
+        }
+    }
+
+    // Compacta todos os fragmentos em paralelo. Devolve as métricas de cada fragmento
+    // na ordem de Biblioteca::compactar, um fragmento após o outro.
+    vector<pair<MetricasArvore, MetricasArvore>> compactar() {
+        anotar(OP_COMPACTAR, {});
+        vector<vector<pair<MetricasArvore, MetricasArvore>>> parciais = emTodos([](Biblioteca& b, size_t) {
+            return b.compactarArvores();
+        });
+        vector<pair<MetricasArvore, MetricasArvore>> metricas;
+        for (const auto& parcial : parciais) {
+            metricas.insert(metricas.end(), parcial.begin(), parcial.end());
+        }
+        return metricas;
+    }
+
+    // Contagens e assinatura do acervo inteiro, com todos os fragmentos travados ao
+    // mesmo tempo.
+    ResumoEstado resumo() {
+        vector<unique_lock<mutex>> guardas = travar(vector<bool>(fragmentos.size(), true));
+        return resumoComTrava();
+    }
+
+    void registrarEstadoFinal() {
+        vector<unique_lock<mutex>> guardas = travar(vector<bool>(fragmentos.size(), true));
+        if (gravador) anotar(OP_ESTADO_FINAL, resumoComTrava().argumentos());
+    }
+
+private:
+    static const size_t TAMANHO_LOTE_EXPORTACAO = 1024;
+
+    GravadorTrace* gravador;  // Destino do trace, compartilhado com os fragmentos, ou nulo.
+    vector<unique_ptr<Biblioteca>> fragmentos;
+    PoolTarefas pool;         // Threads das consultas em todos os fragmentos.
+
+    void anotar(TipoOperacao tipo, const vector<string>& argumentos) {
+        if (gravador) gravador->registrar(tipo, argumentos);
+    }
+
+    // Obtém as travas dos fragmentos marcados em ordem crescente de índice, o que evita
+    // deadlock entre operações que travam vários fragmentos ao mesmo tempo.
+    vector<unique_lock<mutex>> travar(const vector<bool>& envolvidos) {
+        vector<unique_lock<mutex>> guardas;
+        for (size_t f = 0; f < fragmentos.size(); f++) {
+            if (envolvidos[f]) guardas.emplace_back(fragmentos[f]->trava);
+        }
+        return guardas;
+    }
+
+    // Chamado com todos os fragmentos travados.
+    ResumoEstado resumoComTrava() {
+        ResumoEstado total;
+        for (auto& b : fragmentos) {
+            total.somar(b->resumoComTrava());
+        }
+        return total;
+    }
+
+    // Páginas intercaladas, sem registro no trace; usadas pelas listagens e pela
+    // exportação. Cada fragmento é travado só durante a sua página.
+    vector<Livro> paginaLivros(const string& inicio, size_t limite, bool somenteDisponiveis) {
+        return pagina(emTodos([&](Biblioteca& b, size_t) {
+            lock_guard<mutex> guarda(b.trava);
+            return b.paginaLivros(inicio, limite, somenteDisponiveis);
+        }), limite, [](const Livro& a, const Livro& b) { return a.ISBN < b.ISBN; });
+    }
+
+    vector<Usuario> paginaUsuarios(const string& inicio, size_t limite) {
+        return pagina(emTodos([&](Biblioteca& b, size_t) {
+            lock_guard<mutex> guarda(b.trava);
+            return b.paginaUsuarios(inicio, limite);
+        }), limite, [](const Usuario& a, const Usuario& b) { return a.id < b.id; });
+    }
+
+    vector<Emprestimo> paginaEmprestimos(const string& inicio, size_t limite) {
+        return pagina(emTodos([&](Biblioteca& b, size_t) {
+            lock_guard<mutex> guarda(b.trava);
+            return b.paginaEmprestimos(inicio, limite);
+        }), limite, [](const Emprestimo& a, const Emprestimo& b) { return a.tituloLivro < b.tituloLivro; });
+    }
+
+    // Intercala as páginas dos fragmentos e fica com os primeiros limite registros.
+    template <typename V, typename Menor>
+    static vector<V> pagina(vector<vector<V>> parciais, size_t limite, Menor menor) {
+        vector<V> resultado = intercalar(parciais, menor);
+        if (resultado.size() > limite) resultado.resize(limite);
+        return resultado;
+    }
+
+    // Escreve no relatório as páginas devolvidas por proxima, cada uma a partir da
+    // chave seguinte à última da anterior, até uma página incompleta.
+    template <typename Proxima, typename Chave>
+    size_t exportar(Proxima proxima, Relatorio& relatorio, Chave chave) {
+        size_t total = 0;
+        string inicio;
+        for (;;) {
+            auto lote = proxima(inicio);
+            for (const auto& registro : lote) relatorio.registro(registro);
+            total += lote.size();
+            if (lote.size() < TAMANHO_LOTE_EXPORTACAO) return total;
+            inicio = Biblioteca::chaveSeguinte(chave(lote.back()));
+        }
+    }
+
+    // Executa a função em todos os fragmentos ao mesmo tempo, o primeiro na thread que
+    // chamou e os outros no pool, e devolve os resultados na ordem dos fragmentos.
+    // As tarefas podem obter a trava do seu fragmento; por isso quem chama não pode
+    // estar com nenhuma trava de fragmento: uma tarefa de outra consulta, à frente na
+    // fila do pool, poderia esperar por essa trava, e as tarefas de quem chamou nunca
+    // chegariam a rodar. Se alguma execução lançar exceção,
+    // todas as tarefas enfileiradas terminam antes de a primeira exceção ser relançada,
+    // pois elas usam funcao, que deixa de existir quando emTodos retorna.
+    template <typename Funcao>
+    auto emTodos(Funcao funcao) -> vector<decltype(funcao(declval<Biblioteca&>(), size_t()))> {
+        typedef decltype(funcao(declval<Biblioteca&>(), size_t())) Resultado;
+        vector<future<Resultado>> pendentes;
+        pendentes.reserve(fragmentos.size() - 1);
+        vector<Resultado> resultados;
+        resultados.reserve(fragmentos.size());
+
+        exception_ptr erro;
+        try {
+            for (size_t f = 1; f < fragmentos.size(); f++) {
+                pendentes.push_back(pool.executar([&funcao, this, f]() { return funcao(*fragmentos[f], f); }));
+            }
+            resultados.push_back(funcao(*fragmentos[0], 0));
+        } catch (...) {
+            erro = current_exception();
+        }
+        for (auto& pendente : pendentes) {
+            try {
+                Resultado resultado = pendente.get();
+                if (!erro) resultados.push_back(move(resultado));
+            } catch (...) {
+                if (!erro) erro = current_exception();
+            }
+        }
+        if (erro) rethrow_exception(erro);
+        return resultados;
+    }
+};
+
+#endif // BIBLIOTECA_FRAGMENTADA_H
@@ -0,0 +1,337 @@
+#ifndef CATALOGO_COLUNAR_H
+#define CATALOGO_COLUNAR_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include "Livro.h"
+
+// Os kernels AVX2 são compilados com atributo de alvo e escolhidos em tempo de
+// execução, então o binário não precisa de -mavx2 para usá-los.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CATALOGO_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Cópia colunar do catálogo, usada apenas para estatísticas. Cada campo numérico
+// fica em um vetor contíguo (uma linha por livro) e o autor é codificado como um
+// inteiro de um dicionário, de modo que as agregações percorrem memória sequencial
+// em vez de visitar cada BSTNode e cada Livro com suas três strings.
+// A BST continua sendo a fonte de verdade; esta estrutura é mantida em paralelo.
+class CatalogoColunar {
+public:
+    vector<int32_t> numeroPaginas;  // Coluna de páginas, uma posição por livro.
+    vector<uint32_t> autorId;       // Coluna de autores codificados pelo dicionário.
+    vector<string> isbnDaLinha;     // ISBN de cada linha, para localizar remoções.
+    vector<string> autores;         // Dicionário: id do autor -> nome.
+
+    // Adiciona um livro ao final das colunas. ISBNs repetidos são ignorados, como na BST.
+    void adicionar(const Livro& livro) {
+        if (linhaPorIsbn.count(livro.ISBN)) return;
+
+        auto it = idPorAutor.find(livro.autor);
+        uint32_t id;
+        if (it == idPorAutor.end()) {
+            id = autores.size();
+            autores.push_back(livro.autor);
+            idPorAutor[livro.autor] = id;
+        } else {
+            id = it->second;
+        }
+
+        linhaPorIsbn[livro.ISBN] = numeroPaginas.size();
+        numeroPaginas.push_back(livro.numeroPaginas);
+        autorId.push_back(id);
+        isbnDaLinha.push_back(livro.ISBN);
+    }
+
+    // Remove o livro trocando sua linha pela última, para manter as colunas contíguas.
+    bool remover(const string& isbn) {
+        auto it = linhaPorIsbn.find(isbn);
+        if (it == linhaPorIsbn.end()) return false;
+
+        size_t linha = it->second;
+        size_t ultima = numeroPaginas.size() - 1;
+        if (linha != ultima) {
+            numeroPaginas[linha] = numeroPaginas[ultima];
+            autorId[linha] = autorId[ultima];
+            isbnDaLinha[linha] = isbnDaLinha[ultima];
+            linhaPorIsbn[isbnDaLinha[linha]] = linha;
+        }
+        numeroPaginas.pop_back();
+        autorId.pop_back();
+        isbnDaLinha.pop_back();
+        linhaPorIsbn.erase(it);
+        return true;
+    }
+
+    // Descarta as colunas e as reconstrói a partir da árvore de livros.
+    void construir(BSTNode* raiz) {
+        numeroPaginas.clear();
+        autorId.clear();
+        isbnDaLinha.clear();
+        autores.clear();
+        idPorAutor.clear();
+        linhaPorIsbn.clear();
+
+        // Percurso iterativo: a BST não é balanceada e pode ser muito profunda.
+        vector<BSTNode*> pilha;
+        if (raiz) pilha.push_back(raiz);
+        while (!pilha.empty()) {
+            BSTNode* node = pilha.back();
+            pilha.pop_back();
+            adicionar(node->livro);
+            if (node->left) pilha.push_back(node->left);
+            if (node->right) pilha.push_back(node->right);
+        }
+    }
+
+    // Número de livros nas colunas.
+    size_t tamanho() const {
+        return numeroPaginas.size();
+    }
+
+    // Soma de todas as páginas do catálogo.
+    long long somaPaginas() const {
+#if defined(CATALOGO_SIMD_X86)
+        if (usarAvx2()) return somaPaginasAvx2(numeroPaginas.data(), numeroPaginas.size());
+#endif
+        long long soma = 0;
+        for (int32_t paginas : numeroPaginas) {
+            soma += paginas;
+        }
+        return soma;
+    }
+
+    // Menor e maior número de páginas. Retorna false se o catálogo estiver vazio.
+    bool minMaxPaginas(int& menor, int& maior) const {
+        const int32_t* p = numeroPaginas.data();
+        size_t n = numeroPaginas.size();
+        if (n == 0) return false;
+
+        int32_t mn = INT32_MAX, mx = INT32_MIN;
+        size_t i = 0;
+#if defined(CATALOGO_SIMD_X86)
+        if (usarAvx2()) {
+            i = minMaxPaginasAvx2(p, n, mn, mx);
+        }
+#endif
+        for (; i < n; i++) {
+            mn = min(mn, p[i]);
+            mx = max(mx, p[i]);
+        }
+        menor = mn;
+        maior = mx;
+        return true;
+    }
+
+    // Distribuição de páginas em numFaixas faixas de largura fixa; a última faixa
+    // acumula tudo que passar do limite e a primeira tudo que ficar abaixo de zero.
+    // Retorna um vetor vazio se largura ou numFaixas não forem positivos.
+    vector<size_t> histogramaPaginas(int largura, int numFaixas) const {
+        if (largura <= 0 || numFaixas <= 0) return {};
+#if defined(CATALOGO_SIMD_X86)
+        if (usarAvx2() && numFaixas <= MAX_FAIXAS_SIMD) {
+            return histogramaPaginasAvx2(numeroPaginas.data(), numeroPaginas.size(), largura, numFaixas);
+        }
+#endif
+        // Quatro histogramas parciais, para que incrementos seguidos na mesma faixa
+        // não dependam um do outro.
+        vector<size_t> parciais(4 * numFaixas, 0);
+        const int32_t* p = numeroPaginas.data();
+        size_t n = numeroPaginas.size();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            for (int k = 0; k < 4; k++) {
+                parciais[k * numFaixas + faixaDe(p[i + k], largura, numFaixas)]++;
+            }
+        }
+        for (; i < n; i++) {
+            parciais[faixaDe(p[i], largura, numFaixas)]++;
+        }
+
+        vector<size_t> histograma(numFaixas, 0);
+        for (int k = 0; k < 4; k++) {
+            for (int f = 0; f < numFaixas; f++) {
+                histograma[f] += parciais[k * numFaixas + f];
+            }
+        }
+        return histograma;
+    }
+
+    // Total de páginas por autor, indexado pelo id do dicionário. Como em
+    // histogramaPaginas, quatro tabelas parciais evitam que livros seguidos do mesmo
+    // autor formem uma cadeia de dependência no mesmo contador.
+    vector<long long> paginasPorAutor() const {
+        size_t numAutores = autores.size();
+        vector<long long> parciais(4 * numAutores, 0);
+        const int32_t* p = numeroPaginas.data();
+        const uint32_t* a = autorId.data();
+        size_t n = numeroPaginas.size();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            for (size_t k = 0; k < 4; k++) {
+                parciais[k * numAutores + a[i + k]] += p[i + k];
+            }
+        }
+        for (; i < n; i++) {
+            parciais[a[i]] += p[i];
+        }
+        return somarParciais(parciais, numAutores);
+    }
+
+    // Quantidade de livros por autor, indexada pelo id do dicionário.
+    vector<size_t> livrosPorAutor() const {
+        size_t numAutores = autores.size();
+        vector<size_t> parciais(4 * numAutores, 0);
+        const uint32_t* a = autorId.data();
+        size_t n = autorId.size();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            for (size_t k = 0; k < 4; k++) {
+                parciais[k * numAutores + a[i + k]]++;
+            }
+        }
+        for (; i < n; i++) {
+            parciais[a[i]]++;
+        }
+        return somarParciais(parciais, numAutores);
+    }
+
+    // Kernels AVX2 liberados quando o processador os suporta. Desligar força o
+    // caminho escalar, que serve de referência nos testes.
+    bool permitirSimd = true;
+
+    // Indica se os kernels AVX2 foram compilados e o processador atual os executa.
+    static bool simdDisponivel() {
+#if defined(CATALOGO_SIMD_X86)
+        static const bool disponivel = __builtin_cpu_supports("avx2");
+        return disponivel;
+#else
+        return false;
+#endif
+    }
+
+private:
+    unordered_map<string, uint32_t> idPorAutor;  // Dicionário: nome do autor -> id.
+    unordered_map<string, size_t> linhaPorIsbn;  // Linha ocupada por cada ISBN.
+
+    // Acima disto o histograma vetorial faria comparações demais por elemento.
+    static const int MAX_FAIXAS_SIMD = 64;
+
+    bool usarAvx2() const {
+        return permitirSimd && simdDisponivel();
+    }
+
+    // Faixa de um valor: divisão inteira limitada a [0, numFaixas - 1].
+    static int faixaDe(int32_t paginas, int largura, int numFaixas) {
+        int faixa = paginas / largura;
+        if (faixa < 0) return 0;
+        return faixa < numFaixas ? faixa : numFaixas - 1;
+    }
+
+    template <typename Contador>
+    static vector<Contador> somarParciais(const vector<Contador>& parciais, size_t tamanho) {
+        vector<Contador> totais(tamanho, 0);
+        for (size_t k = 0; k < 4; k++) {
+            for (size_t j = 0; j < tamanho; j++) {
+                totais[j] += parciais[k * tamanho + j];
+            }
+        }
+        return totais;
+    }
+
+#if defined(CATALOGO_SIMD_X86)
+    __attribute__((target("avx2")))
+    static long long somaPaginasAvx2(const int32_t* p, size_t n) {
+        __m256i acumulador = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            acumulador = _mm256_add_epi64(acumulador, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+            acumulador = _mm256_add_epi64(acumulador, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        long long parciais[4];
+        _mm256_storeu_si256((__m256i*)parciais, acumulador);
+        long long soma = parciais[0] + parciais[1] + parciais[2] + parciais[3];
+        for (; i < n; i++) {
+            soma += p[i];
+        }
+        return soma;
+    }
+
+    // Retorna quantos elementos consumiu; o restante fica para o laço escalar.
+    __attribute__((target("avx2")))
+    static size_t minMaxPaginasAvx2(const int32_t* p, size_t n, int32_t& mn, int32_t& mx) {
+        __m256i vmin = _mm256_set1_epi32(INT32_MAX);
+        __m256i vmax = _mm256_set1_epi32(INT32_MIN);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            vmin = _mm256_min_epi32(vmin, v);
+            vmax = _mm256_max_epi32(vmax, v);
+        }
+        int32_t minimos[8], maximos[8];
+        _mm256_storeu_si256((__m256i*)minimos, vmin);
+        _mm256_storeu_si256((__m256i*)maximos, vmax);
+        for (int k = 0; k < 8; k++) {
+            mn = min(mn, minimos[k]);
+            mx = max(mx, maximos[k]);
+        }
+        return i;
+    }
+
+    // Histograma sem espalhamento: para cada limite f * largura (f >= 1) conta quantos
+    // valores são maiores ou iguais a ele, somando as máscaras de comparação em
+    // contadores de 32 bits por via. A faixa f recebe a diferença entre os limites f e
+    // f + 1; a faixa 0 fica com o restante, inclusive os valores negativos.
+    __attribute__((target("avx2")))
+    static vector<size_t> histogramaPaginasAvx2(const int32_t* p, size_t n, int largura, int numFaixas) {
+        // acima[f] conta valores >= f * largura; acima[0] é o total.
+        vector<size_t> acima(numFaixas + 1, 0);
+        acima[0] = n;
+        int limites = 0; // Limites que cabem em int32; os demais não contam ninguém.
+        for (int f = 1; f < numFaixas && (long long)f * largura <= INT32_MAX; f++) {
+            limites = f;
+        }
+
+        // Processa em blocos para que os contadores de 32 bits por via não transbordem.
+        const size_t bloco = (size_t)1 << 30;
+        for (size_t inicio = 0; inicio < n; inicio += bloco) {
+            size_t fim = min(n, inicio + bloco);
+            for (int f = 1; f <= limites; f++) {
+                // v >= limite equivale a v > limite - 1, sem transbordar pois limite >= 1.
+                __m256i limite = _mm256_set1_epi32(f * largura - 1);
+                __m256i contagem = _mm256_setzero_si256();
+                size_t i = inicio;
+                for (; i + 8 <= fim; i += 8) {
+                    __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+                    contagem = _mm256_sub_epi32(contagem, _mm256_cmpgt_epi32(v, limite));
+                }
+                uint32_t vias[8];
+                _mm256_storeu_si256((__m256i*)vias, contagem);
+                size_t total = 0;
+                for (int k = 0; k < 8; k++) total += vias[k];
+                for (; i < fim; i++) {
+                    total += p[i] >= f * largura;
+                }
+                acima[f] += total;
+            }
+        }
+
+        vector<size_t> histograma(numFaixas, 0);
+        for (int f = 0; f + 1 < numFaixas; f++) {
+            histograma[f] = acima[f] - acima[f + 1];
+        }
+        histograma[numFaixas - 1] = acima[numFaixas - 1];
+        return histograma;
+    }
+#endif
+};
+
+#endif // CATALOGO_COLUNAR_H
@@ -0,0 +1,164 @@
+#ifndef CATALOGO_CONGELADO_H
+#define CATALOGO_CONGELADO_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+struct Livro;
+
+// Cópia somente leitura do catálogo, compilada a partir da BST para os períodos em
+// que não há escritas. As chaves ficam em um vetor no layout de Eytzinger (a raiz na
+// posição 1 e os filhos de k em 2k e 2k+1), alinhado à linha de cache, de modo que a
+// busca desce sem desvios condicionais e os próximos níveis podem ser pré-carregados.
+// Cada ISBN é codificado em um inteiro de 64 bits que preserva a ordem das strings,
+// o que troca a comparação de strings por uma comparação de inteiros.
+// A cópia aponta para os livros da BST e deve ser invalidada a cada escrita; a BST
+// faz isso sozinha quando a cópia está ligada a ela (BST::attachFrozen).
+class CatalogoCongelado {
+public:
+    CatalogoCongelado() : chaves(nullptr), n(0), pronto(false), incompativel(false), buscasSemCopia(0) {}
+
+    // Compila o catálogo a partir de um cursor em ordem de ISBN (BSTIterator). Falha,
+    // e a cópia fica inválida, se algum ISBN não puder ser codificado (mais de 18
+    // caracteres ou algo que não seja dígito).
+    template <typename Iterador>
+    bool congelar(Iterador cursor) {
+        pronto = false;
+        vector<uint64_t> ordenadas;
+        vector<Livro*> ordenados;
+        for (; cursor.valido(); cursor.avancar()) {
+            uint64_t codigo;
+            if (!codificar(cursor.atual().ISBN, codigo)) {
+                incompativel = true;
+                return false;
+            }
+            ordenadas.push_back(codigo);
+            ordenados.push_back(const_cast<Livro*>(&cursor.atual()));
+        }
+        congelarCodigos(ordenadas, ordenados);
+        return true;
+    }
+
+    // Compila a cópia a partir de códigos já ordenados e dos livros correspondentes.
+    // Com ordenados vazio a cópia guarda só as chaves: posicao() funciona e buscar()
+    // retorna nulo.
+    void congelarCodigos(const vector<uint64_t>& ordenadas, const vector<Livro*>& ordenados) {
+        n = ordenadas.size();
+        // Reserva uma linha de cache extra para alinhar o início do vetor de chaves.
+        memoria.assign(n + 1 + 8, 0);
+        memoria.shrink_to_fit();
+        uintptr_t endereco = (uintptr_t)memoria.data();
+        chaves = memoria.data() + ((64 - endereco % 64) % 64) / sizeof(uint64_t);
+        livros.assign(ordenados.empty() ? 0 : n + 1, nullptr);
+        livros.shrink_to_fit();
+
+        size_t proximo = 0;
+        preencher(1, ordenadas, ordenados, proximo);
+        pronto = true;
+        incompativel = false;
+    }
+
+    // Descarta a cópia; chamada a cada escrita no catálogo.
+    void invalidar() {
+        pronto = false;
+        incompativel = false;
+        buscasSemCopia = 0;
+    }
+
+    // Conta uma busca feita sem a cópia e diz se já compensa congelar. Congelar custa
+    // um percurso do catálogo inteiro, então exige uma busca para cada
+    // LIVROS_POR_BUSCA livros desde a última escrita (e no mínimo BUSCAS_MINIMAS);
+    // assim o custo fica diluído nas buscas que a cópia vai atender.
+    bool registrarBusca(size_t tamanhoCatalogo) {
+        if (incompativel) return false;
+        buscasSemCopia++;
+        size_t necessarias = tamanhoCatalogo / LIVROS_POR_BUSCA;
+        return buscasSemCopia >= (necessarias > BUSCAS_MINIMAS ? necessarias : BUSCAS_MINIMAS);
+    }
+
+    // Indica se a cópia reflete o catálogo atual.
+    bool valido() const {
+        return pronto;
+    }
+
+    // Indica se a última tentativa de congelar falhou por causa das chaves. Nesse caso
+    // não adianta tentar de novo antes da próxima escrita.
+    bool chavesIncompativeis() const {
+        return incompativel;
+    }
+
+    // Número de livros na cópia.
+    size_t tamanho() const {
+        return n;
+    }
+
+    // Busca pelo ISBN. Só deve ser usada enquanto valido() for verdadeiro.
+    Livro* buscar(const string& isbn) const {
+        size_t k = posicao(isbn);
+        return (k != 0 && !livros.empty()) ? livros[k] : nullptr;
+    }
+
+    // Posição do ISBN no layout, ou 0 se ele não estiver na cópia.
+    size_t posicao(const string& isbn) const {
+        uint64_t alvo;
+        if (!codificar(isbn, alvo)) return 0;
+
+        size_t k = 1;
+        while (k <= n) {
+#if defined(__GNUC__)
+            __builtin_prefetch(chaves + k * 8);  // Três níveis abaixo, uma linha de cache.
+#endif
+            k = 2 * k + (chaves[k] < alvo);
+        }
+        // Desfaz as descidas à direita feitas depois da última à esquerda; o resultado
+        // é a primeira chave maior ou igual ao alvo.
+        while (k & 1) {
+            k >>= 1;
+        }
+        k >>= 1;
+        return (k != 0 && chaves[k] == alvo) ? k : 0;
+    }
+
+    // Codifica uma string de até 18 dígitos em base 11 (dígito d vira d + 1 e as
+    // posições que sobram valem 0), o que preserva a ordem lexicográfica.
+    static bool codificar(const string& isbn, uint64_t& codigo) {
+        if (isbn.size() > 18) return false;
+        codigo = 0;
+        for (size_t i = 0; i < 18; i++) {
+            uint64_t digito = 0;
+            if (i < isbn.size()) {
+                if (isbn[i] < '0' || isbn[i] > '9') return false;
+                digito = isbn[i] - '0' + 1;
+            }
+            codigo = codigo * 11 + digito;
+        }
+        return true;
+    }
+
+private:
+    static const size_t BUSCAS_MINIMAS = 64;
+    static const size_t LIVROS_POR_BUSCA = 16;
+
+    vector<uint64_t> memoria;  // Armazenamento das chaves, com folga para o alinhamento.
+    uint64_t* chaves;          // Chaves em layout de Eytzinger, a partir da posição 1.
+    vector<Livro*> livros;     // Livro correspondente a cada posição de chaves.
+    size_t n;                  // Número de chaves.
+    bool pronto;               // A cópia reflete o catálogo atual.
+    bool incompativel;         // A última tentativa falhou por causa das chaves.
+    size_t buscasSemCopia;     // Buscas atendidas sem a cópia desde a última escrita.
+
+    // Distribui as chaves ordenadas pelo layout com um percurso em ordem implícito.
+    void preencher(size_t k, const vector<uint64_t>& ordenadas, const vector<Livro*>& ordenados, size_t& proximo) {
+        if (k > n) return;
+        preencher(2 * k, ordenadas, ordenados, proximo);
+        chaves[k] = ordenadas[proximo];
+        if (!ordenados.empty()) livros[k] = ordenados[proximo];
+        proximo++;
+        preencher(2 * k + 1, ordenadas, ordenados, proximo);
+    }
+};
+
+#endif // CATALOGO_CONGELADO_H
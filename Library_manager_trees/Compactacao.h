@@ -0,0 +1,318 @@
+#ifndef COMPACTACAO_H
+#define COMPACTACAO_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "Livro.h"
+#include "Usuario.h"
+#include "Emprestimo.h"
+
+using namespace std;
+
+// Métricas de fragmentação de uma árvore, medidas antes e depois da compactação.
+struct MetricasArvore {
+    size_t nos = 0;               // Número de nós.
+    size_t chaves = 0;            // Número de registros.
+    int altura = 0;               // Maior profundidade, contando a raiz como 1.
+    int alturaMinima = 0;         // Menor altura possível para o número de registros.
+    double profundidadeMedia = 0; // Profundidade média dos registros.
+    double ocupacao = 0;          // Registros por posição disponível nos nós.
+    size_t nosSubocupados = 0;    // Nós abaixo da ocupação mínima (só na árvore B).
+    double ligacoesDistantes = 0; // Fração de ligações pai-filho entre páginas de memória diferentes.
+};
+
+// Número de bits necessários para representar n; é a altura de uma árvore binária
+// perfeitamente balanceada com n nós.
+inline int bitsNecessarios(size_t n) {
+    int bits = 0;
+    for (; n; n >>= 1) bits++;
+    return bits;
+}
+
+// Indica se dois nós estão em páginas de memória (4 KiB) diferentes.
+inline bool paginasDiferentes(const void* a, const void* b) {
+    return ((uintptr_t)a >> 12) != ((uintptr_t)b >> 12);
+}
+
+// Mede uma árvore binária (BST ou AVL) com percurso iterativo.
+template <typename No>
+MetricasArvore medirBinaria(No* raiz) {
+    MetricasArvore metricas;
+    size_t somaProfundidades = 0, distantes = 0;
+    vector<pair<No*, int>> pilha;
+    if (raiz) pilha.push_back(make_pair(raiz, 1));
+    while (!pilha.empty()) {
+        No* node = pilha.back().first;
+        int profundidade = pilha.back().second;
+        pilha.pop_back();
+
+        metricas.nos++;
+        somaProfundidades += profundidade;
+        metricas.altura = max(metricas.altura, profundidade);
+        for (No* filho : {node->left, node->right}) {
+            if (filho) {
+                if (paginasDiferentes(node, filho)) distantes++;
+                pilha.push_back(make_pair(filho, profundidade + 1));
+            }
+        }
+    }
+    metricas.chaves = metricas.nos;
+    metricas.alturaMinima = bitsNecessarios(metricas.nos);
+    metricas.ocupacao = metricas.nos ? 1.0 : 0.0;
+    if (metricas.nos) {
+        metricas.profundidadeMedia = (double)somaProfundidades / metricas.nos;
+    }
+    if (metricas.nos > 1) {
+        metricas.ligacoesDistantes = (double)distantes / (metricas.nos - 1);
+    }
+    return metricas;
+}
+
+inline MetricasArvore medir(const BST& arvore) {
+    return medirBinaria(arvore.root);
+}
+
+inline MetricasArvore medir(const AVL& arvore) {
+    return medirBinaria(arvore.root);
+}
+
+// Mede uma árvore B a partir da raiz, que pode já estar fora da árvore.
+inline MetricasArvore medirArvoreB(BTreeNode* raiz) {
+    MetricasArvore metricas;
+    size_t somaProfundidades = 0, distantes = 0;
+    vector<pair<BTreeNode*, int>> pilha;
+    pilha.push_back(make_pair(raiz, 1));
+    while (!pilha.empty()) {
+        BTreeNode* node = pilha.back().first;
+        int profundidade = pilha.back().second;
+        pilha.pop_back();
+
+        metricas.nos++;
+        metricas.chaves += node->emprestimos.size();
+        somaProfundidades += profundidade * node->emprestimos.size();
+        metricas.altura = max(metricas.altura, profundidade);
+        if (node != raiz && node->emprestimos.size() < T - 1) {
+            metricas.nosSubocupados++;
+        }
+        if (!node->folha) {
+            for (BTreeNode* filho : node->filhos) {
+                if (paginasDiferentes(node, filho)) distantes++;
+                pilha.push_back(make_pair(filho, profundidade + 1));
+            }
+        }
+    }
+
+    size_t capacidade = 2 * T - 1;
+    for (metricas.alturaMinima = 1; capacidade < metricas.chaves; metricas.alturaMinima++) {
+        capacidade = capacidade * 2 * T + 2 * T - 1;
+    }
+    metricas.ocupacao = (double)metricas.chaves / (metricas.nos * (2 * T - 1));
+    if (metricas.chaves) {
+        metricas.profundidadeMedia = (double)somaProfundidades / metricas.chaves;
+    }
+    if (metricas.nos > 1) {
+        metricas.ligacoesDistantes = (double)distantes / (metricas.nos - 1);
+    }
+    return metricas;
+}
+
+inline MetricasArvore medir(const BTree& arvore) {
+    return medirArvoreB(arvore.root);
+}
+
+// A AVL precisa da altura de cada nó; na BST não há o que ajustar.
+inline void definirAltura(BSTNode*, int) {}
+inline void definirAltura(AVLNode* node, int altura) { node->height = altura; }
+
+// A cópia congelada da BST aponta para os nós antigos; a AVL não tem cópias.
+inline void descartarCopias(BST& arvore) {
+    if (arvore.congelado) arvore.congelado->invalidar();
+}
+inline void descartarCopias(AVL&) {}
+
+// Monta uma árvore perfeitamente balanceada a partir de valores ordenados. Os nós são
+// criados em pré-ordem no bloco contíguo de destino, de modo que cada filho esquerdo
+// fica logo depois do pai e subárvores pequenas ficam na mesma página.
+template <typename No, typename Valor>
+No* construirBalanceada(const vector<Valor>& ordenados, ArenaNos<No>& destino) {
+    struct Faixa {
+        size_t inicio, fim;  // Intervalo [inicio, fim) de ordenados.
+        No** destino;        // Ponteiro do pai que receberá o nó.
+    };
+
+    destino.reservar(ordenados.size());
+    No* raiz = nullptr;
+    vector<Faixa> pilha;
+    if (!ordenados.empty()) pilha.push_back(Faixa{0, ordenados.size(), &raiz});
+    while (!pilha.empty()) {
+        Faixa faixa = pilha.back();
+        pilha.pop_back();
+        size_t meio = faixa.inicio + (faixa.fim - faixa.inicio) / 2;
+        No* node = destino.criar(ordenados[meio]);
+        definirAltura(node, bitsNecessarios(faixa.fim - faixa.inicio));
+        *faixa.destino = node;
+        if (meio + 1 < faixa.fim) pilha.push_back(Faixa{meio + 1, faixa.fim, &node->right});
+        if (faixa.inicio < meio) pilha.push_back(Faixa{faixa.inicio, meio, &node->left});
+    }
+    return raiz;
+}
+
+// Libera uma árvore binária sem recursão, pois a BST pode estar degenerada. Os nós
+// vêm de dono ou do alocador comum.
+template <typename No>
+void liberarBinaria(No* raiz, ArenaNos<No>& dono) {
+    vector<No*> pilha;
+    if (raiz) pilha.push_back(raiz);
+    while (!pilha.empty()) {
+        No* node = pilha.back();
+        pilha.pop_back();
+        if (node->left) pilha.push_back(node->left);
+        if (node->right) pilha.push_back(node->right);
+        dono.descartar(node);
+    }
+}
+
+// Reconstrói a BST balanceada e com nós próximos na memória. A nova árvore é montada
+// ao lado da atual, a raiz é trocada e só então os nós antigos são liberados. O índice
+// hash, se houver, é refeito e a cópia congelada, que aponta para os livros antigos,
+// é descartada.
+inline void compactar(BST& arvore) {
+    vector<Livro> ordenados;
+    for (BSTIterator it(arvore.root); it.valido(); it.avancar()) {
+        ordenados.push_back(it.atual());
+    }
+    BSTNode* antiga = arvore.root;
+    ArenaNos<BSTNode> nova;
+    arvore.root = construirBalanceada<BSTNode>(ordenados, nova);
+    swap(arvore.arena, nova);
+    arvore.modificacoes++;
+    if (arvore.indice) arvore.reindex();
+    descartarCopias(arvore);
+    liberarBinaria(antiga, nova);
+}
+
+// Reconstrói a AVL da mesma forma que a BST.
+inline void compactar(AVL& arvore) {
+    vector<Usuario> ordenados;
+    for (AVLIterator it(arvore.root); it.valido(); it.avancar()) {
+        ordenados.push_back(it.atual());
+    }
+    AVLNode* antiga = arvore.root;
+    ArenaNos<AVLNode> nova;
+    arvore.root = construirBalanceada<AVLNode>(ordenados, nova);
+    swap(arvore.arena, nova);
+    arvore.modificacoes++;
+    if (arvore.indice) arvore.reindex();
+    liberarBinaria(antiga, nova);
+}
+
+// Reconstrói a árvore B com altura mínima e nós cheios.
+inline void compactar(BTree& arvore) {
+    arvore.compact();
+}
+
+// Registros copiados por etapa na cópia feita sem segurar a trava o tempo todo.
+const size_t ETAPA_COPIA = 4096;
+
+// Copia os registros da árvore em ordem para destino, em etapas de ETAPA_COPIA
+// registros. A trava só é mantida durante cada etapa; entre elas as outras threads
+// seguem operando. O iterador continua válido de uma etapa para a outra enquanto o
+// contador de modificações da árvore não mudar. Retorna false se a árvore mudou no
+// meio da cópia; versao recebe o contador que corresponde à cópia.
+template <typename Iterador, typename Arvore, typename Valor>
+bool copiarEmEtapas(Arvore& arvore, mutex& trava, vector<Valor>& destino, uint64_t& versao) {
+    destino.clear();
+    unique_lock<mutex> guarda(trava);
+    versao = arvore.modificacoes;
+    Iterador it(arvore.root);
+    for (;;) {
+        for (size_t n = 0; n < ETAPA_COPIA && it.valido(); n++, it.avancar()) {
+            destino.push_back(it.atual());
+        }
+        if (!it.valido()) return true;
+        guarda.unlock();
+        this_thread::yield();
+        guarda.lock();
+        if (arvore.modificacoes != versao) return false;
+    }
+}
+
+// Compacta a BST ou a AVL sem bloquear as outras threads durante a reconstrução: os
+// registros são copiados em etapas, a nova árvore e o novo índice hash são montados
+// fora da trava, e a trava volta a ser obtida só para trocar a raiz e o conteúdo do
+// índice. Se a árvore tiver mudado desde a cópia, nada é trocado e a função retorna
+// false. A árvore antiga é medida e liberada depois da troca, também fora da trava.
+template <typename No, typename Iterador, typename Valor, typename Arvore>
+bool compactar(Arvore& arvore, mutex& trava, MetricasArvore& antes, MetricasArvore& depois) {
+    typedef typename remove_pointer<decltype(arvore.indice)>::type Indice;
+    vector<Valor> ordenados;
+    uint64_t versao;
+    if (!copiarEmEtapas<Iterador>(arvore, trava, ordenados, versao)) return false;
+
+    Arvore nova;
+    nova.root = construirBalanceada<No>(ordenados, nova.arena);
+    Indice novoIndice;
+    if (arvore.indice) nova.attachIndex(&novoIndice);
+    depois = medirBinaria(nova.root);
+
+    No* antiga;
+    {
+        lock_guard<mutex> guarda(trava);
+        if (arvore.modificacoes != versao) {
+            liberarBinaria(nova.root, nova.arena);
+            return false;
+        }
+        antiga = arvore.root;
+        arvore.root = nova.root;
+        swap(arvore.arena, nova.arena);
+        arvore.modificacoes++;
+        if (arvore.indice) swap(*arvore.indice, novoIndice);
+        descartarCopias(arvore);
+    }
+    // A arena antiga agora está em nova e é devolvida ao sair.
+    antes = medirBinaria(antiga);
+    liberarBinaria(antiga, nova.arena);
+    return true;
+}
+
+inline bool compactar(BST& arvore, mutex& trava, MetricasArvore& antes, MetricasArvore& depois) {
+    return compactar<BSTNode, BSTIterator, Livro>(arvore, trava, antes, depois);
+}
+
+inline bool compactar(AVL& arvore, mutex& trava, MetricasArvore& antes, MetricasArvore& depois) {
+    return compactar<AVLNode, AVLIterator, Usuario>(arvore, trava, antes, depois);
+}
+
+// Compacta a árvore B da mesma forma que a BST e a AVL.
+inline bool compactar(BTree& arvore, mutex& trava, MetricasArvore& antes, MetricasArvore& depois) {
+    vector<Emprestimo> ordenados;
+    uint64_t versao;
+    if (!copiarEmEtapas<BTreeIterator>(arvore, trava, ordenados, versao)) return false;
+
+    ArenaNos<BTreeNode> arenaNova;
+    BTreeNode* nova = arvore.build(ordenados, arenaNova);
+    depois = medirArvoreB(nova);
+
+    BTreeNode* antiga;
+    {
+        lock_guard<mutex> guarda(trava);
+        if (arvore.modificacoes != versao) {
+            arvore.destroy(nova, arenaNova);
+            return false;
+        }
+        antiga = arvore.root;
+        arvore.root = nova;
+        swap(arvore.arena, arenaNova);
+        arvore.modificacoes++;
+    }
+    antes = medirArvoreB(antiga);
+    arvore.destroy(antiga, arenaNova);
+    return true;
+}
+
+#endif // COMPACTACAO_H
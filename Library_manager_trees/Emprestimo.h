@@ -4,6 +4,8 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include "ArenaNos.h"
 
 using namespace std;
 
@@ -33,13 +35,29 @@ public:
 class BTree {
 public:
     BTreeNode* root; // Ponteiro para o nó raiz da árvore.
+    uint64_t modificacoes; // Muda a cada chamada que pode alterar a árvore.
+    ArenaNos<BTreeNode> arena; // Nós da última reconstrução; os demais vêm de new.
 
-    BTree() {
+    BTree() : modificacoes(0), numEmprestimos(0) {
         root = new BTreeNode(true); // Inicializa a árvore com um nó raiz que é uma folha.
     }
 
+    ~BTree() {
+        liberar(root);
+    }
+
+    // A árvore é dona dos nós; uma cópia liberaria os mesmos nós duas vezes.
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    // Número de empréstimos na árvore.
+    size_t size() const {
+        return numEmprestimos;
+    }
+
     // Insere um novo empréstimo na árvore B.
     void insert(Emprestimo emprestimo) {
+        modificacoes++;
         // Se a raiz estiver cheia, cria um novo nó e divide a raiz.
         if (root->emprestimos.size() == 2 * T - 1) {
             BTreeNode* s = new BTreeNode(false);
@@ -48,6 +66,27 @@ public:
             root = s;
         }
         insertNonFull(root, emprestimo);
+        numEmprestimos++;
+    }
+
+    // Insere um lote de empréstimos de uma só vez. O lote é ordenado e distribuído
+    // pelos filhos em uma única descida, de modo que cada folha é visitada uma vez
+    // para todas as chaves que caem nela, em vez de uma descida por empréstimo.
+    void insertBatch(vector<Emprestimo> lote) {
+        modificacoes++;
+        stable_sort(lote.begin(), lote.end(), menorTitulo);
+        numEmprestimos += lote.size();
+
+        size_t pos = 0;
+        while (pos < lote.size()) {
+            if (root->emprestimos.size() == 2 * T - 1) {
+                BTreeNode* s = new BTreeNode(false);
+                s->filhos.push_back(root);
+                splitChild(s, 0, root);
+                root = s;
+            }
+            pos = insertBatchNonFull(root, lote, pos, nullptr);
+        }
     }
 
     // Dividir o filho y do nó x no índice i.
@@ -91,6 +130,39 @@ public:
         }
     }
 
+    // Insere no nó x as chaves do lote, a partir de pos, que pertencem à sua faixa
+    // (menores que limite, quando houver). Para quando a faixa termina ou quando x
+    // fica cheio e precisa ser dividido pelo pai; retorna a próxima posição do lote.
+    size_t insertBatchNonFull(BTreeNode* x, const vector<Emprestimo>& lote, size_t pos, const string* limite) {
+        if (x->folha) {
+            size_t espaco = 2 * T - 1 - x->emprestimos.size();
+            size_t fim = pos;
+            while (fim < lote.size() && fim - pos < espaco && (!limite || lote[fim].tituloLivro < *limite)) {
+                fim++;
+            }
+            size_t meio = x->emprestimos.size();
+            x->emprestimos.insert(x->emprestimos.end(), lote.begin() + pos, lote.begin() + fim);
+            inplace_merge(x->emprestimos.begin(), x->emprestimos.begin() + meio, x->emprestimos.end(), menorTitulo);
+            return fim;
+        }
+
+        while (pos < lote.size() && (!limite || lote[pos].tituloLivro < *limite)) {
+            size_t i = upper_bound(x->emprestimos.begin(), x->emprestimos.end(), lote[pos], menorTitulo) - x->emprestimos.begin();
+            if (x->filhos[i]->emprestimos.size() == 2 * T - 1) {
+                if (x->emprestimos.size() == 2 * T - 1) {
+                    break; // Sem espaço para subir a mediana; o pai divide x e retoma daqui.
+                }
+                splitChild(x, i, x->filhos[i]);
+                if (!(lote[pos].tituloLivro < x->emprestimos[i].tituloLivro)) {
+                    i++;
+                }
+            }
+            const string* limiteFilho = i < x->emprestimos.size() ? &x->emprestimos[i].tituloLivro : limite;
+            pos = insertBatchNonFull(x->filhos[i], lote, pos, limiteFilho);
+        }
+        return pos;
+    }
+
     // Realiza o percurso em ordem para recolher todos os empréstimos em ordem.
     void inorder(BTreeNode* node, vector<Emprestimo>& result) {
         size_t i;
@@ -123,8 +195,10 @@ public:
         return search(node->filhos[i], tituloLivro); // Procura no filho adequado.
     }
 
-    // Remove um empréstimo com o título específico.
-    BTreeNode* remove(BTreeNode* node, const string& tituloLivro) {
+    // Remove um empréstimo com o título específico. Se removido for informado, recebe o
+    // empréstimo retirado; quem chama sabe se a chave existia pela mudança em size().
+    BTreeNode* remove(BTreeNode* node, const string& tituloLivro, Emprestimo* removido = nullptr) {
+        modificacoes++;
         if (!node) return nullptr;
 
         size_t idx = 0;
@@ -134,22 +208,30 @@ public:
 
         if (idx < node->emprestimos.size() && node->emprestimos[idx].tituloLivro == tituloLivro) {
             if (node->folha) {
+                if (removido) *removido = move(node->emprestimos[idx]);
                 node->emprestimos.erase(node->emprestimos.begin() + idx);
+                numEmprestimos--;
             } else {
+                if (removido && (node->filhos[idx]->emprestimos.size() >= T || node->filhos[idx + 1]->emprestimos.size() >= T)) {
+                    *removido = node->emprestimos[idx];
+                }
                 if (node->filhos[idx]->emprestimos.size() >= T) {
                     BTreeNode* predecessor = node->filhos[idx];
                     while (!predecessor->folha) {
                         predecessor = predecessor->filhos.back();
                     }
                     node->emprestimos[idx] = predecessor->emprestimos.back();
-                    remove(node->filhos[idx], predecessor->emprestimos.back().tituloLivro);
+                    // A chave é copiada porque o nó de onde ela vem pode ser alterado na descida.
+                    string chave = predecessor->emprestimos.back().tituloLivro;
+                    remove(node->filhos[idx], chave);
                 } else if (node->filhos[idx + 1]->emprestimos.size() >= T) {
                     BTreeNode* successor = node->filhos[idx + 1];
                     while (!successor->folha) {
                         successor = successor->filhos.front();
                     }
                     node->emprestimos[idx] = successor->emprestimos.front();
-                    remove(node->filhos[idx + 1], successor->emprestimos.front().tituloLivro);
+                    string chave = successor->emprestimos.front().tituloLivro;
+                    remove(node->filhos[idx + 1], chave);
                 } else {
                     BTreeNode* child = node->filhos[idx];
                     BTreeNode* sibling = node->filhos[idx + 1];
@@ -160,8 +242,8 @@ public:
                     }
                     node->emprestimos.erase(node->emprestimos.begin() + idx);
                     node->filhos.erase(node->filhos.begin() + idx + 1);
-                    delete sibling;
-                    remove(child, tituloLivro);
+                    arena.descartar(sibling);
+                    remove(child, tituloLivro, removido);
                 }
             }
         } else {
@@ -175,15 +257,245 @@ public:
             }
 
             if (flag && idx > node->emprestimos.size()) {
-                remove(node->filhos[idx - 1], tituloLivro);
+                remove(node->filhos[idx - 1], tituloLivro, removido);
             } else {
-                remove(node->filhos[idx], tituloLivro);
+                remove(node->filhos[idx], tituloLivro, removido);
             }
         }
+
+        // Só a raiz pode ficar sem chaves, depois de juntar seus dois últimos filhos;
+        // nesse caso a árvore perde um nível.
+        if (node->emprestimos.empty() && !node->folha) {
+            BTreeNode* filho = node->filhos[0];
+            arena.descartar(node);
+            return filho;
+        }
         return node;
     }
 
+    // Remove de uma só vez todos os empréstimos cujas chaves estão no conjunto. Lotes
+    // pequenos perto do tamanho da árvore são removidos chave a chave; os grandes são
+    // separados por intercalação com o lote ordenado em um único percurso, e a árvore é
+    // reconstruída compacta no final. Os empréstimos retirados são devolvidos em
+    // removidos, quando informado. Retorna quantos foram removidos.
+    size_t removeBatch(vector<string> chaves, vector<Emprestimo>* removidos = nullptr) {
+        sort(chaves.begin(), chaves.end());
+        chaves.erase(unique(chaves.begin(), chaves.end()), chaves.end());
+        return removerChaves(chaves, removidos);
+    }
+
+    // Remove todos os empréstimos que satisfazem o predicado, por exemplo todos os de
+    // um usuário. O predicado é avaliado em ordem de chave, sem alterar a árvore; as
+    // chaves escolhidas são então removidas como em removeBatch.
+    template <typename Predicado>
+    size_t removeIf(Predicado predicado, vector<Emprestimo>* removidos = nullptr) {
+        vector<string> chaves;
+        selecionar(root, predicado, chaves);
+        return removerChaves(chaves, removidos);
+    }
+
+    // Reconstrói a árvore com altura mínima e nós tão cheios quanto possível. A nova
+    // árvore é montada ao lado da atual e só então substitui a raiz; os nós antigos
+    // são liberados depois da troca.
+    void compact() {
+        modificacoes++;
+        vector<Emprestimo> todos;
+        inorder(root, todos);
+        BTreeNode* antiga = root;
+        ArenaNos<BTreeNode> nova;
+        root = construir(todos, nova);
+        swap(arena, nova);
+        liberar(antiga, nova);
+    }
+
+    // Monta, fora da árvore, uma raiz com os empréstimos já ordenados e sem chaves
+    // repetidas, no mesmo formato de compact(), com os nós em destino. Permite preparar
+    // a nova árvore sem bloquear quem usa a atual e depois trocar a raiz e a arena.
+    BTreeNode* build(vector<Emprestimo>& ordenados, ArenaNos<BTreeNode>& destino) {
+        return construir(ordenados, destino);
+    }
+
+    // Libera uma subárvore que já não está ligada à árvore, como a raiz antiga depois
+    // de uma troca; dono é a arena em que a subárvore foi construída.
+    void destroy(BTreeNode* node, ArenaNos<BTreeNode>& dono) {
+        liberar(node, dono);
+    }
+
 private:
+    size_t numEmprestimos; // Mantido por insert, insertBatch, remove e removerChaves.
+
+    // Abaixo de uma chave removida para cada LIMITE_RECONSTRUCAO empréstimos na árvore,
+    // remover chave a chave (O(k log n)) custa menos que desmontar e reconstruir (O(n)).
+    static const size_t LIMITE_RECONSTRUCAO = 8;
+
+    // Ordena empréstimos pela chave (ISBN guardado em tituloLivro).
+    static bool menorTitulo(const Emprestimo& a, const Emprestimo& b) {
+        return a.tituloLivro < b.tituloLivro;
+    }
+
+    // Acrescenta a chaves, em ordem, as chaves dos empréstimos que satisfazem o predicado.
+    template <typename Predicado>
+    void selecionar(BTreeNode* node, Predicado& predicado, vector<string>& chaves) {
+        size_t i;
+        for (i = 0; i < node->emprestimos.size(); i++) {
+            if (!node->folha) {
+                selecionar(node->filhos[i], predicado, chaves);
+            }
+            if (predicado(node->emprestimos[i])) {
+                chaves.push_back(node->emprestimos[i].tituloLivro);
+            }
+        }
+        if (!node->folha) {
+            selecionar(node->filhos[i], predicado, chaves);
+        }
+    }
+
+    // Remove as chaves, já ordenadas e sem repetição, pelo caminho mais barato para o
+    // tamanho do lote. Retorna quantos empréstimos foram removidos.
+    size_t removerChaves(const vector<string>& chaves, vector<Emprestimo>* removidos) {
+        if (chaves.empty()) return 0;
+        modificacoes++;
+
+        if (chaves.size() * LIMITE_RECONSTRUCAO < numEmprestimos) {
+            // Uma descida por chave: remove já diz, pelo tamanho, se a chave existia.
+            size_t quantidade = 0;
+            Emprestimo removido;
+            for (const auto& chave : chaves) {
+                size_t antes = numEmprestimos;
+                root = remove(root, chave, removidos ? &removido : nullptr);
+                if (numEmprestimos == antes) continue;
+                if (removidos) removidos->push_back(move(removido));
+                quantidade++;
+            }
+            return quantidade;
+        }
+
+        vector<Emprestimo> todos;
+        desmontar(root, todos);
+
+        size_t mantidos = 0, j = 0;
+        for (size_t i = 0; i < todos.size(); i++) {
+            while (j < chaves.size() && chaves[j] < todos[i].tituloLivro) {
+                j++;
+            }
+            if (j < chaves.size() && chaves[j] == todos[i].tituloLivro) {
+                if (removidos) removidos->push_back(move(todos[i]));
+            } else {
+                if (mantidos != i) todos[mantidos] = move(todos[i]);
+                mantidos++;
+            }
+        }
+        size_t quantidade = todos.size() - mantidos;
+        todos.resize(mantidos);
+
+        // Os nós antigos já foram descartados por desmontar; a arena antiga, agora em
+        // nova, só guarda posições vazias e é devolvida ao sair.
+        ArenaNos<BTreeNode> nova;
+        root = construir(todos, nova);
+        swap(arena, nova);
+        numEmprestimos = mantidos;
+        return quantidade;
+    }
+
+    // Move os empréstimos da subárvore para destino, em ordem, liberando os nós.
+    void desmontar(BTreeNode* node, vector<Emprestimo>& destino) {
+        size_t i;
+        for (i = 0; i < node->emprestimos.size(); i++) {
+            if (!node->folha) {
+                desmontar(node->filhos[i], destino);
+            }
+            destino.push_back(move(node->emprestimos[i]));
+        }
+        if (!node->folha) {
+            desmontar(node->filhos[i], destino);
+        }
+        arena.descartar(node);
+    }
+
+    // Libera todos os nós da subárvore.
+    void liberar(BTreeNode* node) {
+        liberar(node, arena);
+    }
+
+    // Libera uma subárvore cujos nós vêm de dono ou do alocador comum.
+    static void liberar(BTreeNode* node, ArenaNos<BTreeNode>& dono) {
+        if (!node->folha) {
+            for (BTreeNode* filho : node->filhos) {
+                liberar(filho, dono);
+            }
+        }
+        dono.descartar(node);
+    }
+
+    // Maior número de chaves que cabe em uma subárvore com a altura dada.
+    static size_t capacidade(int altura) {
+        size_t total = 1;
+        for (int i = 0; i < altura; i++) {
+            total *= 2 * T;
+        }
+        return total - 1;
+    }
+
+    // Constrói uma árvore B a partir de empréstimos já ordenados, com a menor altura
+    // possível e os nós tão cheios quanto a distribuição uniforme permite. Os nós vão
+    // para destino, reservada com o número exato de nós, em pré-ordem.
+    static BTreeNode* construir(vector<Emprestimo>& ordenados, ArenaNos<BTreeNode>& destino) {
+        int altura = 1;
+        while (capacidade(altura) < ordenados.size()) {
+            altura++;
+        }
+        destino.reservar(contarNos(ordenados.size(), altura));
+        return construir(ordenados, 0, ordenados.size(), altura, destino);
+    }
+
+    // Divide n chaves de uma subárvore com a altura dada (maior que 1) entre o menor
+    // número de filhos capaz de guardá-las; sobra uma chave entre cada par de filhos.
+    static void repartir(size_t n, int altura, size_t& numFilhos, size_t& chavesFilhos) {
+        size_t capacidadeFilho = capacidade(altura - 1);
+        numFilhos = (n + 1 + capacidadeFilho) / (capacidadeFilho + 1);
+        chavesFilhos = n - (numFilhos - 1);
+    }
+
+    // Número de nós que construir cria para n chaves com a altura dada.
+    static size_t contarNos(size_t n, int altura) {
+        if (altura == 1) return 1;
+        size_t numFilhos, chavesFilhos;
+        repartir(n, altura, numFilhos, chavesFilhos);
+        size_t base = chavesFilhos / numFilhos, maiores = chavesFilhos % numFilhos;
+        size_t nos = 1 + (numFilhos - maiores) * contarNos(base, altura - 1);
+        if (maiores) nos += maiores * contarNos(base + 1, altura - 1);
+        return nos;
+    }
+
+    // Constrói a subárvore com as chaves do intervalo [inicio, fim) e a altura dada.
+    static BTreeNode* construir(vector<Emprestimo>& ordenados, size_t inicio, size_t fim, int altura,
+                                ArenaNos<BTreeNode>& destino) {
+        BTreeNode* node = destino.criar(altura == 1);
+        if (altura == 1) {
+            node->emprestimos.reserve(fim - inicio);
+            for (size_t i = inicio; i < fim; i++) {
+                node->emprestimos.push_back(move(ordenados[i]));
+            }
+            return node;
+        }
+
+        // Usa o menor número de filhos capaz de guardar as chaves e reparte o resto
+        // igualmente entre eles, o que mantém cada filho acima da ocupação mínima.
+        size_t numFilhos, chavesFilhos;
+        repartir(fim - inicio, altura, numFilhos, chavesFilhos);
+
+        size_t pos = inicio;
+        for (size_t c = 0; c < numFilhos; c++) {
+            size_t quantidade = chavesFilhos / numFilhos + (c < chavesFilhos % numFilhos ? 1 : 0);
+            node->filhos.push_back(construir(ordenados, pos, pos + quantidade, altura - 1, destino));
+            pos += quantidade;
+            if (c + 1 < numFilhos) {
+                node->emprestimos.push_back(move(ordenados[pos++]));
+            }
+        }
+        return node;
+    }
+
     void fill(BTreeNode* node, int idx) {
         if (idx != 0 && node->filhos[idx - 1]->emprestimos.size() >= T) {
             borrowFromPrev(node, idx);
@@ -198,80 +510,99 @@ private:
         }
     }
 
+    // Passa a última chave do irmão esquerdo para o pai e a chave do pai para o filho.
     void borrowFromPrev(BTreeNode* node, int idx) {
         BTreeNode* child = node->filhos[idx];
         BTreeNode* sibling = node->filhos[idx - 1];
 
-        for (int i = child->emprestimos.size() - 1; i >= 0; --i) {
-            child->emprestimos[i + 1] = child->emprestimos[i];
-        }
-
-        if (!child->folha) {
-            for (int i = child->filhos.size() - 1; i >= 0; --i) {
-                child->filhos[i + 1] = child->filhos[i];
-            }
-        }
-
-        child->emprestimos[0] = node->emprestimos[idx - 1];
-
+        child->emprestimos.insert(child->emprestimos.begin(), node->emprestimos[idx - 1]);
         if (!child->folha) {
-            child->filhos[0] = sibling->filhos[sibling->filhos.size() - 1];
+            child->filhos.insert(child->filhos.begin(), sibling->filhos.back());
+            sibling->filhos.pop_back();
         }
 
-        node->emprestimos[idx - 1] = sibling->emprestimos[sibling->emprestimos.size() - 1];
-
+        node->emprestimos[idx - 1] = sibling->emprestimos.back();
         sibling->emprestimos.pop_back();
-        sibling->filhos.pop_back();
-
-        child->emprestimos.insert(child->emprestimos.begin(), node->emprestimos[idx - 1]);
     }
 
+    // Passa a primeira chave do irmão direito para o pai e a chave do pai para o filho.
     void borrowFromNext(BTreeNode* node, int idx) {
         BTreeNode* child = node->filhos[idx];
         BTreeNode* sibling = node->filhos[idx + 1];
 
         child->emprestimos.push_back(node->emprestimos[idx]);
-
         if (!child->folha) {
-            child->filhos.push_back(sibling->filhos[0]);
+            child->filhos.push_back(sibling->filhos.front());
+            sibling->filhos.erase(sibling->filhos.begin());
         }
 
-        node->emprestimos[idx] = sibling->emprestimos[0];
-
+        node->emprestimos[idx] = sibling->emprestimos.front();
         sibling->emprestimos.erase(sibling->emprestimos.begin());
-        sibling->filhos.erase(sibling->filhos.begin());
-
-        child->emprestimos.push_back(node->emprestimos[idx]);
     }
 
+    // Junta o filho idx, a chave idx do pai e o filho idx + 1 em um único nó.
     void merge(BTreeNode* node, int idx) {
         BTreeNode* child = node->filhos[idx];
         BTreeNode* sibling = node->filhos[idx + 1];
 
         child->emprestimos.push_back(node->emprestimos[idx]);
-
-        for (int i = 0; i < sibling->emprestimos.size(); ++i) {
-            child->emprestimos.push_back(sibling->emprestimos[i]);
+        child->emprestimos.insert(child->emprestimos.end(), sibling->emprestimos.begin(), sibling->emprestimos.end());
+        if (!child->folha) {
+            child->filhos.insert(child->filhos.end(), sibling->filhos.begin(), sibling->filhos.end());
         }
 
-        if (!child->folha) {
-            for (int i = 0; i <= sibling->filhos.size(); ++i) {
-                child->filhos.push_back(sibling->filhos[i]);
+        node->emprestimos.erase(node->emprestimos.begin() + idx);
+        node->filhos.erase(node->filhos.begin() + idx + 1);
+
+        arena.descartar(sibling);
+    }
+};
+
+// Iterador em ordem sobre a árvore B. Cada posição da pilha guarda um nó e o índice
+// do próximo empréstimo a emitir nele. Pode começar na primeira chave maior ou igual
+// a inicio, o que permite retomar uma listagem paginada de onde parou.
+class BTreeIterator {
+public:
+    BTreeIterator(BTreeNode* raiz, const string& inicio = "") {
+        BTreeNode* node = raiz;
+        while (node) {
+            size_t i = 0;
+            while (i < node->emprestimos.size() && node->emprestimos[i].tituloLivro < inicio) {
+                i++;
             }
+            pilha.push_back(make_pair(node, i));
+            node = node->folha ? nullptr : node->filhos[i];
         }
+        ajustar();
+    }
 
-        for (int i = idx + 1; i < node->emprestimos.size(); ++i) {
-            node->emprestimos[i - 1] = node->emprestimos[i];
-        }
+    // Indica se ainda há empréstimos a visitar.
+    bool valido() const { return !pilha.empty(); }
+
+    // Empréstimo na posição atual do cursor.
+    const Emprestimo& atual() const { return pilha.back().first->emprestimos[pilha.back().second]; }
 
-        for (int i = idx + 2; i <= node->filhos.size(); ++i) {
-            node->filhos[i - 1] = node->filhos[i];
+    // Avança para o próximo empréstimo em ordem de chave.
+    void avancar() {
+        BTreeNode* node = pilha.back().first;
+        size_t i = ++pilha.back().second;
+        if (!node->folha) {
+            for (node = node->filhos[i]; ; node = node->filhos[0]) {
+                pilha.push_back(make_pair(node, 0));
+                if (node->folha) break;
+            }
         }
+        ajustar();
+    }
 
-        node->emprestimos.pop_back();
-        node->filhos.pop_back();
+private:
+    vector<pair<BTreeNode*, size_t>> pilha;  // Caminho da raiz até a posição atual.
 
-        delete sibling;
+    // Descarta nós cujos empréstimos já foram todos emitidos.
+    void ajustar() {
+        while (!pilha.empty() && pilha.back().second >= pilha.back().first->emprestimos.size()) {
+            pilha.pop_back();
+        }
     }
 };
 
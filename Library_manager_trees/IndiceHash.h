@@ -0,0 +1,133 @@
+#ifndef INDICE_HASH_H
+#define INDICE_HASH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+using namespace std;
+
+// Índice hash de endereçamento aberto (Robin Hood com sondagem linear) que associa
+// uma chave de texto ao registro guardado em uma árvore. A chave não é copiada: é
+// lida do próprio registro através do membro Chave (por exemplo &Livro::ISBN).
+// Cada entrada guarda o hash completo, então a comparação de strings só acontece
+// quando os hashes coincidem, e as sondagens percorrem posições vizinhas da tabela.
+// O índice não é dono dos registros; quem o usa deve removê-lo antes de liberar um
+// registro e atualizá-lo quando o registro mudar de endereço.
+template <typename V, string V::*Chave>
+class IndiceHash {
+public:
+    IndiceHash() : tabela(16), ocupadas(0) {}
+
+    // Retorna o registro com a chave, ou nulo se não houver.
+    V* buscar(const string& chave) const {
+        size_t pos;
+        return localizar(chave, calcularHash(chave), pos) ? tabela[pos].valor : nullptr;
+    }
+
+    // Insere o registro ou, se a chave já existir, passa a apontar para ele.
+    void inserir(V* valor) {
+        const string& chave = valor->*Chave;
+        uint32_t hash = calcularHash(chave);
+        size_t pos;
+        if (localizar(chave, hash, pos)) {
+            tabela[pos].valor = valor;
+            return;
+        }
+
+        if ((ocupadas + 1) * 8 > tabela.size() * 7) {
+            crescer();
+        }
+        posicionar(Entrada{hash, 1, valor});
+        ocupadas++;
+    }
+
+    // Remove a chave, deslocando para trás as entradas seguintes do mesmo grupo.
+    bool remover(const string& chave) {
+        size_t pos;
+        if (!localizar(chave, calcularHash(chave), pos)) return false;
+
+        size_t mascara = tabela.size() - 1;
+        size_t proxima = (pos + 1) & mascara;
+        while (tabela[proxima].distancia > 1) {
+            tabela[pos] = tabela[proxima];
+            tabela[pos].distancia--;
+            pos = proxima;
+            proxima = (proxima + 1) & mascara;
+        }
+        tabela[pos] = Entrada();
+        ocupadas--;
+        return true;
+    }
+
+    // Esvazia o índice.
+    void limpar() {
+        tabela.assign(16, Entrada());
+        ocupadas = 0;
+    }
+
+    // Número de chaves indexadas.
+    size_t tamanho() const {
+        return ocupadas;
+    }
+
+private:
+    struct Entrada {
+        uint32_t hash = 0;      // Hash da chave.
+        uint32_t distancia = 0; // 1 + distância da posição ideal; 0 marca posição livre.
+        V* valor = nullptr;     // Registro indexado.
+
+        Entrada() = default;
+        Entrada(uint32_t h, uint32_t d, V* v) : hash(h), distancia(d), valor(v) {}
+    };
+
+    vector<Entrada> tabela;  // Tamanho sempre potência de dois.
+    size_t ocupadas;         // Entradas em uso.
+
+    static uint32_t calcularHash(const string& chave) {
+        uint64_t h = std::hash<string>()(chave);
+        return (uint32_t)(h ^ (h >> 32));
+    }
+
+    // Procura a chave. Para assim que encontra uma entrada mais próxima da sua posição
+    // ideal do que a chave procurada estaria, o que o Robin Hood garante ser o fim.
+    bool localizar(const string& chave, uint32_t hash, size_t& pos) const {
+        size_t mascara = tabela.size() - 1;
+        pos = hash & mascara;
+        for (uint32_t distancia = 1; tabela[pos].distancia >= distancia; distancia++) {
+            if (tabela[pos].hash == hash && tabela[pos].valor->*Chave == chave) {
+                return true;
+            }
+            pos = (pos + 1) & mascara;
+        }
+        return false;
+    }
+
+    // Coloca a entrada, cedendo a posição a quem está mais longe da sua ideal.
+    void posicionar(Entrada entrada) {
+        size_t mascara = tabela.size() - 1;
+        size_t pos = entrada.hash & mascara;
+        while (tabela[pos].distancia != 0) {
+            if (tabela[pos].distancia < entrada.distancia) {
+                swap(tabela[pos], entrada);
+            }
+            pos = (pos + 1) & mascara;
+            entrada.distancia++;
+        }
+        tabela[pos] = entrada;
+    }
+
+    // Dobra a tabela e reposiciona todas as entradas.
+    void crescer() {
+        vector<Entrada> antiga(tabela.size() * 2);
+        antiga.swap(tabela);
+        for (const Entrada& entrada : antiga) {
+            if (entrada.distancia != 0) {
+                posicionar(Entrada(entrada.hash, 1, entrada.valor));
+            }
+        }
+    }
+};
+
+#endif // INDICE_HASH_H
@@ -3,6 +3,10 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include "IndiceHash.h"
+#include "CatalogoCongelado.h"
+#include "ArenaNos.h"
 
 using namespace std;
 
@@ -31,17 +35,67 @@ struct BSTNode {
     BSTNode(Livro l) : livro(l), left(nullptr), right(nullptr) {}
 };
 
+// Índice hash de livros por ISBN.
+typedef IndiceHash<Livro, &Livro::ISBN> IndiceLivros;
+
 // Classe para a árvore binária de busca.
 class BST {
 public:
     BSTNode* root;        // Raiz da árvore.
+    IndiceLivros* indice; // Índice hash opcional, mantido em sincronia com a árvore.
+    CatalogoCongelado* congelado; // Cópia congelada opcional, invalidada a cada escrita.
+    size_t numLivros;     // Número de livros na árvore.
+    uint64_t modificacoes; // Muda a cada chamada que pode alterar a árvore.
+    ArenaNos<BSTNode> arena; // Nós da última reconstrução; os demais vêm de new.
 
     // Construtor da árvore.
-    BST() : root(nullptr) {}
+    BST() : root(nullptr), indice(nullptr), congelado(nullptr), numLivros(0), modificacoes(0) {}
+
+    // Associa um índice hash à árvore e o preenche com os livros já cadastrados.
+    void attachIndex(IndiceLivros* i) {
+        indice = i;
+        reindex();
+    }
+
+    // Refaz o índice associado a partir dos nós atuais, depois que a árvore é
+    // reconstruída. Não troca o ponteiro do índice, que pode ser lido fora da trava.
+    void reindex() {
+        indice->limpar();
+        vector<BSTNode*> pilha;
+        if (root) pilha.push_back(root);
+        while (!pilha.empty()) {
+            BSTNode* node = pilha.back();
+            pilha.pop_back();
+            indice->inserir(&node->livro);
+            if (node->left) pilha.push_back(node->left);
+            if (node->right) pilha.push_back(node->right);
+        }
+    }
+
+    // Associa uma cópia congelada à árvore. Ela é compilada sob demanda pelas buscas e
+    // descartada a cada inserção ou remoção.
+    void attachFrozen(CatalogoCongelado* c) {
+        congelado = c;
+        congelado->invalidar();
+    }
+
+    // Busca pontual pelo ISBN. Em períodos só de leitura usa a cópia congelada, que é
+    // (re)compilada depois de buscas suficientes desde a última escrita; fora deles
+    // usa o índice hash quando houver, senão a árvore. Como pode congelar, não deve
+    // ser chamada em paralelo com outras buscas.
+    Livro* lookup(const string& isbn);
 
     // Função para inserir um livro na árvore.
     BSTNode* insert(BSTNode* node, Livro livro) {
-        if (!node) return new BSTNode(livro);  // Se o nó é nulo, cria um novo nó com o livro.
+        modificacoes++;
+        if (!node) {
+            // Se o nó é nulo, cria um novo nó com o livro.
+            BSTNode* novo = new BSTNode(livro);
+            if (indice) indice->inserir(&novo->livro);
+            if (congelado) congelado->invalidar();
+            numLivros++;
+            return novo;
+        }
 
         // Decide em qual subárvore inserir baseado no ISBN.
         if (livro.ISBN < node->livro.ISBN)
@@ -54,6 +108,7 @@ public:
 
     // Função para remover um livro pelo ISBN.
     BSTNode* remove(BSTNode* node, string isbn) {
+        modificacoes++;
         if (!node) return node;  // Se o nó é nulo, retorna nulo.
 
         // Navega pela árvore para encontrar o livro a ser removido.
@@ -63,13 +118,17 @@ public:
             node->right = remove(node->right, isbn);
         else {
             // Quando o livro é encontrado, verifica a estrutura dos filhos para remover corretamente.
+            if (indice) indice->remover(isbn);
+            if (congelado) congelado->invalidar();
             if (!node->left) {
                 BSTNode* temp = node->right;
-                delete node;
+                arena.descartar(node);
+                numLivros--;
                 return temp;
             } else if (!node->right) {
                 BSTNode* temp = node->left;
-                delete node;
+                arena.descartar(node);
+                numLivros--;
                 return temp;
             }
 
@@ -77,6 +136,7 @@ public:
             BSTNode* temp = minValueNode(node->right);
             node->livro = temp->livro;
             node->right = remove(node->right, temp->livro.ISBN);
+            if (indice) indice->inserir(&node->livro);  // O sucessor mudou de nó.
         }
         return node;
     }
@@ -110,4 +170,48 @@ public:
     }
 };
 
+// Iterador em ordem sobre a BST com pilha explícita. Pode começar na primeira chave
+// maior ou igual a inicio, o que permite retomar uma listagem paginada de onde parou.
+class BSTIterator {
+public:
+    BSTIterator(BSTNode* raiz, const string& inicio = "") {
+        while (raiz) {
+            if (raiz->livro.ISBN < inicio) {
+                raiz = raiz->right;
+            } else {
+                pilha.push_back(raiz);
+                raiz = raiz->left;
+            }
+        }
+    }
+
+    // Indica se ainda há livros a visitar.
+    bool valido() const { return !pilha.empty(); }
+
+    // Livro na posição atual do cursor.
+    const Livro& atual() const { return pilha.back()->livro; }
+
+    // Avança para o próximo livro em ordem de ISBN.
+    void avancar() {
+        BSTNode* node = pilha.back()->right;
+        pilha.pop_back();
+        for (; node; node = node->left) {
+            pilha.push_back(node);
+        }
+    }
+
+private:
+    vector<BSTNode*> pilha;  // Ancestrais ainda não visitados.
+};
+
+inline Livro* BST::lookup(const string& isbn) {
+    if (congelado) {
+        if (!congelado->valido() && congelado->registrarBusca(numLivros)) {
+            congelado->congelar(BSTIterator(root));
+        }
+        if (congelado->valido()) return congelado->buscar(isbn);
+    }
+    return indice ? indice->buscar(isbn) : search(root, isbn);
+}
+
 #endif // LIVRO_H
@@ -0,0 +1,82 @@
+#ifndef POOL_TAREFAS_H
+#define POOL_TAREFAS_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+using namespace std;
+
+// Conjunto fixo de threads que executa tarefas em ordem de chegada. As threads são
+// criadas uma vez e vivem até a destruição do pool, o que evita criar uma thread por
+// tarefa em consultas curtas e frequentes.
+class PoolTarefas {
+public:
+    explicit PoolTarefas(size_t numThreads) : encerrando(false) {
+        for (size_t i = 0; i < numThreads; i++) {
+            threads.emplace_back([this]() { trabalhar(); });
+        }
+    }
+
+    // Espera as tarefas já enfileiradas terminarem e encerra as threads.
+    ~PoolTarefas() {
+        {
+            lock_guard<mutex> guarda(trava);
+            encerrando = true;
+        }
+        aviso.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    PoolTarefas(const PoolTarefas&) = delete;
+    PoolTarefas& operator=(const PoolTarefas&) = delete;
+
+    size_t tamanho() const {
+        return threads.size();
+    }
+
+    // Enfileira a tarefa e devolve o futuro do seu resultado. As tarefas não devem
+    // esperar por outras tarefas do mesmo pool.
+    template <typename Funcao>
+    auto executar(Funcao funcao) -> future<decltype(funcao())> {
+        typedef decltype(funcao()) Resultado;
+        shared_ptr<packaged_task<Resultado()>> tarefa = make_shared<packaged_task<Resultado()>>(move(funcao));
+        future<Resultado> resultado = tarefa->get_future();
+        {
+            lock_guard<mutex> guarda(trava);
+            fila.push([tarefa]() { (*tarefa)(); });
+        }
+        aviso.notify_one();
+        return resultado;
+    }
+
+private:
+    vector<thread> threads;
+    queue<function<void()>> fila;  // Tarefas ainda não iniciadas.
+    mutex trava;                   // Protege a fila e encerrando.
+    condition_variable aviso;      // Sinaliza tarefa nova ou encerramento.
+    bool encerrando;
+
+    void trabalhar() {
+        for (;;) {
+            function<void()> tarefa;
+            {
+                unique_lock<mutex> guarda(trava);
+                aviso.wait(guarda, [this]() { return encerrando || !fila.empty(); });
+                if (fila.empty()) return;
+                tarefa = move(fila.front());
+                fila.pop();
+            }
+            tarefa();
+        }
+    }
+};
+
+#endif // POOL_TAREFAS_H
@@ -0,0 +1,226 @@
+#ifndef RELATORIO_H
+#define RELATORIO_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Livro.h"
+#include "Usuario.h"
+#include "Emprestimo.h"
+
+using namespace std;
+
+// Formatos aceitos pelos relatórios.
+enum FormatoRelatorio {
+    FORMATO_TEXTO,  // "Campo: valor, Campo: valor", uma linha por registro.
+    FORMATO_CSV,    // Cabeçalho seguido de uma linha por registro.
+    FORMATO_JSON    // Um vetor de objetos, um objeto por linha.
+};
+
+// Escritor com buffer grande sobre um FILE*. O texto é acumulado em memória e só é
+// entregue ao sistema quando o buffer enche ou em descarregar(), de modo que uma
+// listagem inteira custa poucas chamadas de escrita em vez de uma por linha.
+// Erros de escrita ficam registrados e são informados por descarregar() e ok().
+class SaidaBufferizada {
+public:
+    SaidaBufferizada(FILE* d, size_t c = 1 << 20) : destino(d), capacidade(c) {
+        buffer.reserve(capacidade);
+    }
+
+    ~SaidaBufferizada() {
+        descarregar();
+    }
+
+    SaidaBufferizada& operator<<(const string& texto) {
+        buffer.append(texto);
+        verificar();
+        return *this;
+    }
+
+    SaidaBufferizada& operator<<(const char* texto) {
+        buffer.append(texto);
+        verificar();
+        return *this;
+    }
+
+    SaidaBufferizada& operator<<(char c) {
+        buffer.push_back(c);
+        verificar();
+        return *this;
+    }
+
+    SaidaBufferizada& operator<<(long long n) {
+        char digitos[24];
+        int tamanho = snprintf(digitos, sizeof(digitos), "%lld", n);
+        buffer.append(digitos, tamanho);
+        verificar();
+        return *this;
+    }
+
+    // Entrega ao destino tudo o que está no buffer. Retorna false se alguma escrita
+    // falhou, agora ou antes; depois de uma falha o texto restante é descartado.
+    bool descarregar() {
+        escrever();
+        if (fflush(destino) != 0) falhou = true;
+        return !falhou;
+    }
+
+    // Indica se todas as escritas até agora chegaram ao destino.
+    bool ok() const {
+        return !falhou;
+    }
+
+private:
+    FILE* destino;       // Arquivo ou stdout.
+    size_t capacidade;   // Tamanho a partir do qual o buffer é descarregado.
+    string buffer;       // Texto ainda não entregue.
+    bool falhou = false; // Alguma escrita foi curta ou deu erro.
+
+    void verificar() {
+        if (buffer.size() >= capacidade) {
+            escrever();
+        }
+    }
+
+    void escrever() {
+        if (!buffer.empty() && !falhou &&
+            fwrite(buffer.data(), 1, buffer.size(), destino) != buffer.size()) {
+            falhou = true;
+        }
+        buffer.clear();
+    }
+};
+
+// Escreve registros de livros, usuários ou empréstimos em um dos formatos aceitos.
+// O cabeçalho do CSV e a abertura do vetor JSON são emitidos no primeiro registro;
+// finalizar() fecha o JSON e deve ser chamado ao fim da listagem.
+class Relatorio {
+public:
+    Relatorio(SaidaBufferizada& s, FormatoRelatorio f) : saida(s), formato(f) {}
+
+    void registro(const Livro& livro) {
+        static const char* nomes[] = {"ISBN", "Titulo", "Autor", "Paginas"};
+        const string* valores[] = {&livro.ISBN, &livro.titulo, &livro.autor, nullptr};
+        escrever(nomes, valores, 4, livro.numeroPaginas);
+    }
+
+    void registro(const Usuario& usuario) {
+        static const char* nomes[] = {"ID", "Nome", "Contato"};
+        const string* valores[] = {&usuario.id, &usuario.nome, &usuario.contato};
+        escrever(nomes, valores, 3, 0);
+    }
+
+    void registro(const Emprestimo& emprestimo) {
+        static const char* nomes[] = {"ISBN", "Usuario", "Emprestimo", "Devolucao"};
+        const string* valores[] = {&emprestimo.tituloLivro, &emprestimo.idUsuario,
+                                   &emprestimo.dataEmprestimo, &emprestimo.dataDevolucao};
+        escrever(nomes, valores, 4, 0);
+    }
+
+    // Fecha o relatório. Em JSON, uma listagem vazia resulta em "[]".
+    void finalizar() {
+        if (formato == FORMATO_JSON) {
+            saida << (registros == 0 ? "[" : "\n") << "]\n";
+        }
+    }
+
+    // Número de registros escritos até agora.
+    size_t total() const {
+        return registros;
+    }
+
+private:
+    SaidaBufferizada& saida;
+    FormatoRelatorio formato;
+    size_t registros = 0;
+
+    // Escreve um registro. Um valor nulo indica o campo numérico, passado à parte.
+    void escrever(const char** nomes, const string** valores, int campos, long long numero) {
+        if (formato == FORMATO_CSV && registros == 0) {
+            for (int c = 0; c < campos; c++) {
+                saida << (c ? "," : "") << nomes[c];
+            }
+            saida << '\n';
+        }
+        if (formato == FORMATO_JSON) {
+            saida << (registros == 0 ? "[\n" : ",\n") << '{';
+        }
+
+        for (int c = 0; c < campos; c++) {
+            switch (formato) {
+                case FORMATO_TEXTO:
+                    saida << (c ? ", " : "") << nomes[c] << ": ";
+                    if (valores[c]) saida << *valores[c]; else saida << numero;
+                    break;
+                case FORMATO_CSV:
+                    if (c) saida << ',';
+                    if (valores[c]) escreverCsv(*valores[c]); else saida << numero;
+                    break;
+                case FORMATO_JSON:
+                    saida << (c ? ", \"" : "\"") << nomes[c] << "\": ";
+                    if (valores[c]) escreverJson(*valores[c]); else saida << numero;
+                    break;
+            }
+        }
+
+        if (formato == FORMATO_JSON) {
+            saida << '}';
+        } else {
+            saida << '\n';
+        }
+        registros++;
+    }
+
+    // Valores com vírgula, aspas ou quebra de linha vão entre aspas, com aspas dobradas.
+    void escreverCsv(const string& valor) {
+        if (valor.find_first_of(",\"\n\r") == string::npos) {
+            saida << valor;
+            return;
+        }
+        saida << '"';
+        for (char c : valor) {
+            if (c == '"') saida << '"';
+            saida << c;
+        }
+        saida << '"';
+    }
+
+    // Escapa aspas, barras e caracteres de controle.
+    void escreverJson(const string& valor) {
+        saida << '"';
+        for (unsigned char c : valor) {
+            switch (c) {
+                case '"': saida << "\\\""; break;
+                case '\\': saida << "\\\\"; break;
+                case '\n': saida << "\\n"; break;
+                case '\r': saida << "\\r"; break;
+                case '\t': saida << "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        char codigo[8];
+                        snprintf(codigo, sizeof(codigo), "\\u%04x", c);
+                        saida << codigo;
+                    } else {
+                        saida << (char)c;
+                    }
+            }
+        }
+        saida << '"';
+    }
+};
+
+// Escreve até tamanhoPagina registros a partir do cursor, pulando os que o filtro
+// rejeita, e deixa o cursor na posição seguinte. Retorna quantos foram escritos.
+template <typename Iterador, typename Filtro>
+size_t escreverPagina(Iterador& cursor, Relatorio& relatorio, size_t tamanhoPagina, Filtro filtro) {
+    size_t escritos = 0;
+    for (; cursor.valido() && escritos < tamanhoPagina; cursor.avancar()) {
+        if (filtro(cursor.atual())) {
+            relatorio.registro(cursor.atual());
+            escritos++;
+        }
+    }
+    return escritos;
+}
+
+#endif // RELATORIO_H
@@ -0,0 +1,268 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+// Operações da biblioteca que podem ser gravadas e reproduzidas.
+enum TipoOperacao : uint8_t {
+    OP_CADASTRAR_LIVRO = 1,   // isbn, titulo, autor, paginas
+    OP_REMOVER_LIVRO,         // isbn
+    OP_BUSCAR_LIVRO,          // isbn
+    OP_CADASTRAR_USUARIO,     // id, nome, contato
+    OP_REMOVER_USUARIO,       // id
+    OP_BUSCAR_USUARIO,        // id
+    OP_REGISTRAR_EMPRESTIMO,  // idUsuario, dataEmprestimo, dataDevolucao, isbn...
+    OP_DEVOLVER_LIVRO,        // isbn, dataDevolucao
+    OP_DEVOLVER_LOTE,         // dataDevolucao, isbn...
+    OP_EXPURGAR_HISTORICO,    // data
+    OP_LISTAR_LIVROS,         // inicio, limite, somenteDisponiveis (1 ou 0)
+    OP_LISTAR_USUARIOS,       // inicio, limite
+    OP_LISTAR_EMPRESTIMOS,    // inicio, limite
+    OP_EXPORTAR_RELATORIO,    // tipo (1 livros, 2 usuarios, 3 emprestimos)
+    OP_ESTATISTICAS,          // largura, faixas
+    OP_CONSULTAR_HISTORICO,   // isbn
+    OP_COMPACTAR,             // sem argumentos
+    OP_ESTADO_FINAL,          // livros, usuarios, emprestimos, arquivados, assinatura
+    OP_TOTAL
+};
+
+// Nome de cada operação, para relatórios.
+inline const char* nomeOperacao(int tipo) {
+    static const char* nomes[OP_TOTAL] = {
+        "?", "cadastrarLivro", "removerLivro", "buscarLivro", "cadastrarUsuario",
+        "removerUsuario", "buscarUsuario", "registrarEmprestimo", "devolverLivro",
+        "devolverLote", "expurgarHistorico", "listarLivros", "listarUsuarios",
+        "listarEmprestimos", "exportarRelatorio", "estatisticas", "consultarHistorico",
+        "compactar", "estadoFinal"
+    };
+    return (tipo > 0 && tipo < OP_TOTAL) ? nomes[tipo] : nomes[0];
+}
+
+// Operação lida de um trace.
+struct OperacaoTrace {
+    TipoOperacao tipo;
+    uint64_t instante;          // Microssegundos desde o início da gravação.
+    vector<string> argumentos;
+};
+
+// Formato do arquivo: a assinatura "LMTR" e um byte de versão, seguidos dos registros.
+// Cada registro tem o tipo (1 byte), a diferença de tempo para o registro anterior em
+// microssegundos, o número de argumentos e cada argumento como tamanho e bytes. Os
+// números usam 7 bits por byte, com o bit alto indicando continuação.
+// Uma operação que não cabe nos limites de um registro continua nos seguintes: o bit
+// alto do tipo indica que o próximo registro é uma continuação, com o tipo
+// OP_CONTINUACAO, um número que vale 1 quando o seu primeiro argumento completa o
+// último argumento do registro anterior, e os argumentos. A versão 2 introduziu as
+// continuações; arquivos da versão 1 continuam legíveis.
+static const char ASSINATURA_TRACE[4] = {'L', 'M', 'T', 'R'};
+static const uint8_t VERSAO_TRACE = 2;
+static const uint8_t OP_CONTINUACAO = 0x7f;
+static const uint8_t BIT_CONTINUA = 0x80;
+static_assert(OP_TOTAL <= OP_CONTINUACAO, "tipos de operacao colidem com OP_CONTINUACAO");
+
+// Limites de um registro. O gravador divide em continuações o que passar deles; no
+// leitor, um valor acima indica arquivo corrompido, e o registro é recusado em vez de
+// alocar o que o arquivo pede.
+static const uint64_t MAXIMO_ARGUMENTOS_TRACE = 1 << 16;
+static const uint64_t MAXIMO_TAMANHO_ARGUMENTO = 1 << 20;
+
+// Grava operações em um trace binário. Pode ser usado por várias threads.
+class GravadorTrace {
+public:
+    GravadorTrace() : arquivo(nullptr), ultimo(0) {}
+
+    ~GravadorTrace() {
+        fechar();
+    }
+
+    // Cria o arquivo e escreve o cabeçalho. Retorna false se não puder abrir.
+    bool abrir(const string& caminho) {
+        fechar();
+        arquivo = fopen(caminho.c_str(), "wb");
+        if (!arquivo) return false;
+        fwrite(ASSINATURA_TRACE, 1, 4, arquivo);
+        fwrite(&VERSAO_TRACE, 1, 1, arquivo);
+        inicio = chrono::steady_clock::now();
+        ultimo = 0;
+        return true;
+    }
+
+    bool aberto() const {
+        return arquivo != nullptr;
+    }
+
+    // Acrescenta uma operação ao trace. Os registros são montados no buffer e entregues
+    // ao sistema na mesma chamada, para que um programa interrompido (Ctrl+C) não perca
+    // as últimas operações. Uma operação acima dos limites de um registro é dividida
+    // em continuações: argumentos longos são cortados em pedaços de até
+    // MAXIMO_TAMANHO_ARGUMENTO bytes, um por registro, e cada registro leva até
+    // MAXIMO_ARGUMENTOS_TRACE pedaços.
+    void registrar(TipoOperacao tipo, const vector<string>& argumentos) {
+        lock_guard<mutex> guarda(trava);
+        if (!arquivo) return;
+
+        uint64_t agora = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - inicio).count();
+        size_t proximo = 0, posicao = 0;  // Argumento do próximo pedaço e onde ele começa.
+        for (bool primeiro = true;; primeiro = false) {
+            // Conta os pedaços que cabem neste registro. Um argumento cortado encerra o
+            // registro, pois só o primeiro argumento de uma continuação pode completá-lo.
+            size_t a = proximo, p = posicao, pedacos = 0;
+            while (pedacos < MAXIMO_ARGUMENTOS_TRACE && a < argumentos.size()) {
+                pedacos++;
+                if (argumentos[a].size() - p > MAXIMO_TAMANHO_ARGUMENTO) {
+                    p += MAXIMO_TAMANHO_ARGUMENTO;
+                    break;
+                }
+                a++;
+                p = 0;
+            }
+            bool continua = a < argumentos.size();
+
+            uint8_t marca = continua ? BIT_CONTINUA : 0;
+            if (primeiro) {
+                buffer.push_back(tipo | marca);
+                escreverNumero(agora - ultimo);
+            } else {
+                buffer.push_back(OP_CONTINUACAO | marca);
+                escreverNumero(posicao > 0 ? 1 : 0);
+            }
+            escreverNumero(pedacos);
+            for (size_t n = 0; n < pedacos; n++) {
+                const string& argumento = argumentos[proximo];
+                size_t tamanho = min<size_t>(argumento.size() - posicao, MAXIMO_TAMANHO_ARGUMENTO);
+                escreverNumero(tamanho);
+                buffer.insert(buffer.end(), argumento.begin() + posicao, argumento.begin() + posicao + tamanho);
+                posicao += tamanho;
+                if (posicao == argumento.size()) {
+                    proximo++;
+                    posicao = 0;
+                }
+            }
+            descarregar();
+            if (!continua) break;
+        }
+        ultimo = agora;
+        fflush(arquivo);
+    }
+
+    // Grava o que estiver no buffer e fecha o arquivo.
+    void fechar() {
+        lock_guard<mutex> guarda(trava);
+        if (!arquivo) return;
+        descarregar();
+        fflush(arquivo);
+        fclose(arquivo);
+        arquivo = nullptr;
+    }
+
+private:
+    FILE* arquivo;
+    vector<uint8_t> buffer;               // Registro em montagem.
+    chrono::steady_clock::time_point inicio;
+    uint64_t ultimo;                      // Instante do registro anterior.
+    mutex trava;
+
+    void escreverNumero(uint64_t valor) {
+        while (valor >= 0x80) {
+            buffer.push_back((uint8_t)(valor | 0x80));
+            valor >>= 7;
+        }
+        buffer.push_back((uint8_t)valor);
+    }
+
+    void descarregar() {
+        fwrite(buffer.data(), 1, buffer.size(), arquivo);
+        buffer.clear();
+    }
+};
+
+// Lê um trace gravado por GravadorTrace.
+class LeitorTrace {
+public:
+    LeitorTrace() : arquivo(nullptr), instante(0) {}
+
+    ~LeitorTrace() {
+        if (arquivo) fclose(arquivo);
+    }
+
+    // Abre o arquivo e confere o cabeçalho.
+    bool abrir(const string& caminho) {
+        arquivo = fopen(caminho.c_str(), "rb");
+        if (!arquivo) return false;
+        char assinatura[4];
+        int versao;
+        if (fread(assinatura, 1, 4, arquivo) != 4 || string(assinatura, 4) != string(ASSINATURA_TRACE, 4)) return false;
+        versao = fgetc(arquivo);
+        return versao >= 1 && versao <= VERSAO_TRACE;
+    }
+
+    // Lê a próxima operação, juntando as continuações. Retorna false no fim do arquivo,
+    // em registro truncado ou em registro acima dos limites.
+    bool proxima(OperacaoTrace& operacao) {
+        int tipo = fgetc(arquivo);
+        if (tipo == EOF) return false;
+        bool continua = tipo & BIT_CONTINUA;
+        tipo &= ~BIT_CONTINUA;
+        if (tipo <= 0 || tipo >= OP_TOTAL) return false;
+
+        uint64_t diferenca;
+        if (!lerNumero(diferenca)) return false;
+        instante += diferenca;
+        operacao.tipo = (TipoOperacao)tipo;
+        operacao.instante = instante;
+        operacao.argumentos.clear();
+        if (!lerArgumentos(operacao.argumentos, false)) return false;
+
+        while (continua) {
+            tipo = fgetc(arquivo);
+            if (tipo == EOF || (tipo & ~BIT_CONTINUA) != OP_CONTINUACAO) return false;
+            continua = tipo & BIT_CONTINUA;
+            uint64_t junta;
+            if (!lerNumero(junta) || junta > 1 || (junta && operacao.argumentos.empty())) return false;
+            if (!lerArgumentos(operacao.argumentos, junta)) return false;
+        }
+        return true;
+    }
+
+private:
+    FILE* arquivo;
+    uint64_t instante;  // Instante acumulado da última operação lida.
+
+    // Lê os argumentos de um registro e os acrescenta aos já lidos. Com junta, o
+    // primeiro deles completa o último argumento do registro anterior.
+    bool lerArgumentos(vector<string>& argumentos, bool junta) {
+        uint64_t quantidade;
+        if (!lerNumero(quantidade) || quantidade > MAXIMO_ARGUMENTOS_TRACE) return false;
+        for (uint64_t i = 0; i < quantidade; i++) {
+            uint64_t tamanho;
+            if (!lerNumero(tamanho) || tamanho > MAXIMO_TAMANHO_ARGUMENTO) return false;
+            if (!junta || i > 0) argumentos.emplace_back();
+            string& argumento = argumentos.back();
+            size_t inicio = argumento.size();
+            argumento.resize(inicio + tamanho);
+            if (tamanho && fread(&argumento[inicio], 1, tamanho, arquivo) != tamanho) return false;
+        }
+        return true;
+    }
+
+    bool lerNumero(uint64_t& valor) {
+        valor = 0;
+        for (int deslocado = 0; deslocado < 64; deslocado += 7) {
+            int byte = fgetc(arquivo);
+            if (byte == EOF) return false;
+            valor |= (uint64_t)(byte & 0x7f) << deslocado;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+#endif // TRACE_H
@@ -0,0 +1,137 @@
+#ifndef TRANSACAO_H
+#define TRANSACAO_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "Livro.h"
+#include "Usuario.h"
+#include "Emprestimo.h"
+
+using namespace std;
+
+// Resultado da confirmação de uma transação de empréstimo.
+enum ResultadoTransacao {
+    TRANSACAO_CONFIRMADA,  // Todos os empréstimos foram gravados.
+    TRANSACAO_VAZIA,       // Carrinho sem livros; nada a fazer.
+    USUARIO_INEXISTENTE,   // O usuário não está cadastrado na AVL.
+    LIVRO_INEXISTENTE,     // Algum ISBN não está cadastrado na BST.
+    LIVRO_JA_EMPRESTADO,   // Algum livro já consta na árvore B de empréstimos.
+    LIVRO_REPETIDO         // O mesmo ISBN aparece duas vezes no carrinho.
+};
+
+// Regras de validação de um carrinho, comuns à biblioteca única e à fragmentada. Não
+// altera nada e deve ser chamada com as árvores envolvidas já travadas. As funções
+// informam se o usuário existe, se o livro existe e se o livro já está emprestado.
+// Em caso de falha, falha recebe o ISBN responsável, quando houver um.
+template <typename UsuarioExiste, typename LivroExiste, typename LivroEmprestado>
+ResultadoTransacao validarCarrinho(const vector<string>& carrinho, const string& idUsuario,
+                                   UsuarioExiste usuarioExiste, LivroExiste livroExiste,
+                                   LivroEmprestado livroEmprestado, string& falha) {
+    if (carrinho.empty()) return TRANSACAO_VAZIA;
+    if (!usuarioExiste(idUsuario)) return USUARIO_INEXISTENTE;
+
+    vector<string> ordenados(carrinho);
+    sort(ordenados.begin(), ordenados.end());
+    for (size_t i = 0; i < ordenados.size(); i++) {
+        if (i > 0 && ordenados[i] == ordenados[i - 1]) {
+            falha = ordenados[i];
+            return LIVRO_REPETIDO;
+        }
+        if (!livroExiste(ordenados[i])) {
+            falha = ordenados[i];
+            return LIVRO_INEXISTENTE;
+        }
+        if (livroEmprestado(ordenados[i])) {
+            falha = ordenados[i];
+            return LIVRO_JA_EMPRESTADO;
+        }
+    }
+    return TRANSACAO_CONFIRMADA;
+}
+
+// Transação que empresta um carrinho de livros a um usuário de forma atômica.
+// Todos os itens são validados contra a AVL de usuários e a BST de livros antes de
+// qualquer escrita, e só então os empréstimos entram na árvore B em um único lote.
+// Validação e gravação acontecem sob a mesma trava, então nenhuma outra transação
+// pode emprestar o mesmo livro entre a verificação e a inserção. Se qualquer item
+// falhar, nada é gravado e o carrinho é descartado (rollback).
+class TransacaoEmprestimo {
+public:
+    // Construtor que associa a transação às árvores e à trava que as protege.
+    TransacaoEmprestimo(BST& l, AVL& u, BTree& e, mutex& m,
+                        string iu, string de, string dd)
+        : livros(l), usuarios(u), emprestimos(e), trava(m),
+          idUsuario(iu), dataEmprestimo(de), dataDevolucao(dd) {}
+
+    // Adiciona um livro ao carrinho. Nada é verificado até a confirmação.
+    void adicionar(const string& isbn) {
+        carrinho.push_back(isbn);
+    }
+
+    // Descarta o carrinho sem gravar nada.
+    void cancelar() {
+        carrinho.clear();
+    }
+
+    // Número de livros no carrinho.
+    size_t tamanho() const {
+        return carrinho.size();
+    }
+
+    // ISBN que causou a última falha de confirmação, se houver.
+    const string& itemComFalha() const {
+        return falha;
+    }
+
+    // Valida o carrinho inteiro e grava todos os empréstimos, ou nenhum.
+    ResultadoTransacao confirmar() {
+        lock_guard<mutex> guarda(trava);
+        return confirmarComTrava();
+    }
+
+    // Como confirmar, para quem já obteve a trava e precisa fazer mais alguma coisa
+    // dentro da mesma seção crítica.
+    ResultadoTransacao confirmarComTrava() {
+        falha.clear();
+
+        ResultadoTransacao resultado = validar();
+        if (resultado != TRANSACAO_CONFIRMADA) {
+            carrinho.clear();
+            return resultado;
+        }
+
+        vector<Emprestimo> lote;
+        lote.reserve(carrinho.size());
+        for (const auto& isbn : carrinho) {
+            lote.emplace_back(isbn, idUsuario, dataEmprestimo, dataDevolucao);
+        }
+        emprestimos.insertBatch(lote);
+        carrinho.clear();
+        return TRANSACAO_CONFIRMADA;
+    }
+
+private:
+    BST& livros;           // Catálogo de livros.
+    AVL& usuarios;         // Cadastro de usuários.
+    BTree& emprestimos;    // Empréstimos ativos.
+    mutex& trava;          // Trava compartilhada pelas três árvores.
+
+    string idUsuario;      // Usuário que retira os livros.
+    string dataEmprestimo; // Data de retirada (dd-mm-aaaa).
+    string dataDevolucao;  // Data prevista de devolução (dd-mm-aaaa).
+    vector<string> carrinho; // ISBNs a emprestar.
+    string falha;          // ISBN que impediu a última confirmação.
+
+    // Verifica todos os itens sem alterar nenhuma árvore. Chamado com a trava obtida.
+    ResultadoTransacao validar() {
+        return validarCarrinho(carrinho, idUsuario,
+            [this](const string& id) { return usuarios.lookup(id) != nullptr; },
+            [this](const string& isbn) { return livros.lookup(isbn) != nullptr; },
+            [this](const string& isbn) { return emprestimos.search(emprestimos.root, isbn) != nullptr; },
+            falha);
+    }
+};
+
+#endif // TRANSACAO_H
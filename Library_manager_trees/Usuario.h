@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include "IndiceHash.h"
+#include "ArenaNos.h"
 
 using namespace std;
 
@@ -29,13 +32,45 @@ struct AVLNode {
     AVLNode(Usuario u) : usuario(u), left(nullptr), right(nullptr), height(1) {}
 };
 
+// Índice hash de usuários por ID.
+typedef IndiceHash<Usuario, &Usuario::id> IndiceUsuarios;
+
 // Classe para gerenciar a árvore AVL.
 class AVL {
 public:
     AVLNode* root;    // Raiz da árvore.
+    IndiceUsuarios* indice;  // Índice hash opcional, mantido em sincronia com a árvore.
+    uint64_t modificacoes;   // Muda a cada chamada que pode alterar a árvore.
+    ArenaNos<AVLNode> arena; // Nós da última reconstrução; os demais vêm de new.
 
     // Construtor da árvore.
-    AVL() : root(nullptr) {}
+    AVL() : root(nullptr), indice(nullptr), modificacoes(0) {}
+
+    // Associa um índice hash à árvore e o preenche com os usuários já cadastrados.
+    void attachIndex(IndiceUsuarios* i) {
+        indice = i;
+        reindex();
+    }
+
+    // Refaz o índice associado a partir dos nós atuais, depois que a árvore é
+    // reconstruída. Não troca o ponteiro do índice, que pode ser lido fora da trava.
+    void reindex() {
+        indice->limpar();
+        vector<AVLNode*> pilha;
+        if (root) pilha.push_back(root);
+        while (!pilha.empty()) {
+            AVLNode* node = pilha.back();
+            pilha.pop_back();
+            indice->inserir(&node->usuario);
+            if (node->left) pilha.push_back(node->left);
+            if (node->right) pilha.push_back(node->right);
+        }
+    }
+
+    // Busca pontual pelo ID: usa o índice hash quando houver, senão a árvore.
+    Usuario* lookup(const string& id) {
+        return indice ? indice->buscar(id) : search(root, id);
+    }
 
     // Retorna a altura de um nó, ou 0 se nulo.
     int height(AVLNode* node) {
@@ -77,7 +112,13 @@ public:
 
     // Insere um usuário na árvore e rebalanceia se necessário.
     AVLNode* insert(AVLNode* node, Usuario usuario) {
-        if (!node) return new AVLNode(usuario);  // Cria um novo nó se o local de inserção é nulo.
+        modificacoes++;
+        if (!node) {
+            // Cria um novo nó se o local de inserção é nulo.
+            AVLNode* novo = new AVLNode(usuario);
+            if (indice) indice->inserir(&novo->usuario);
+            return novo;
+        }
 
         // Inserção de acordo com o ID do usuário.
         if (usuario.id < node->usuario.id)
@@ -118,6 +159,7 @@ public:
 
     // Remove um usuário da árvore e rebalanceia se necessário.
     AVLNode* remove(AVLNode* node, string id) {
+        modificacoes++;
         if (!node) return node;  // Retorna nulo se o nó é nulo.
 
         // Encontra o usuário a ser removido.
@@ -126,19 +168,24 @@ public:
         else if (id > node->usuario.id)
             node->right = remove(node->right, id);
         else {
+            if (indice) indice->remover(id);
             // Casos com zero ou um filho.
             if (!node->left || !node->right) {
                 AVLNode* temp = node->left ? node->left : node->right;
                 if (!temp) {
                     temp = node;
                     node = nullptr;
-                } else *node = *temp;
-                delete temp;
+                } else {
+                    *node = *temp;
+                    if (indice) indice->inserir(&node->usuario);  // O filho subiu para este nó.
+                }
+                arena.descartar(temp);
             } else {
                 // Caso com dois filhos.
                 AVLNode* temp = minValueNode(node->right);
                 node->usuario = temp->usuario;
                 node->right = remove(node->right, temp->usuario.id);
+                if (indice) indice->inserir(&node->usuario);  // O sucessor mudou de nó.
             }
         }
 
@@ -185,4 +232,38 @@ public:
     }
 };
 
+// Iterador em ordem sobre a AVL com pilha explícita. Pode começar no primeiro ID
+// maior ou igual a inicio, o que permite retomar uma listagem paginada de onde parou.
+class AVLIterator {
+public:
+    AVLIterator(AVLNode* raiz, const string& inicio = "") {
+        while (raiz) {
+            if (raiz->usuario.id < inicio) {
+                raiz = raiz->right;
+            } else {
+                pilha.push_back(raiz);
+                raiz = raiz->left;
+            }
+        }
+    }
+
+    // Indica se ainda há usuários a visitar.
+    bool valido() const { return !pilha.empty(); }
+
+    // Usuário na posição atual do cursor.
+    const Usuario& atual() const { return pilha.back()->usuario; }
+
+    // Avança para o próximo usuário em ordem de ID.
+    void avancar() {
+        AVLNode* node = pilha.back()->right;
+        pilha.pop_back();
+        for (; node; node = node->left) {
+            pilha.push_back(node);
+        }
+    }
+
+private:
+    vector<AVLNode*> pilha;  // Ancestrais ainda não visitados.
+};
+
 #endif // USUARIO_H
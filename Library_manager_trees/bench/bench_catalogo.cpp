@@ -0,0 +1,147 @@
+// Compara as buscas por ISBN na BST, no índice hash, no catálogo congelado e no
+// caminho usado pelo sistema (BST::lookup com a cópia congelada ligada).
+// Acima de limiteArvore livros a BST e o índice não cabem na memória; nesse caso só
+// as chaves são geradas e o catálogo congelado é comparado com uma busca binária
+// sobre o mesmo vetor ordenado de códigos.
+// Uso: bench_catalogo [numero de livros] [numero de buscas] [limite da arvore]
+// Compilar a partir de Library_manager_trees: g++ -O2 -I. bench/bench_catalogo.cpp -o bench_catalogo
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+#include "Livro.h"
+#include "CatalogoCongelado.h"
+
+using namespace std;
+
+// Executa as buscas e retorna nanossegundos por busca; soma os acertos em encontrados.
+template <typename Busca>
+double medir(const vector<string>& consultas, Busca busca, size_t& encontrados) {
+    encontrados = 0;
+    auto inicio = chrono::steady_clock::now();
+    for (const auto& isbn : consultas) {
+        if (busca(isbn)) encontrados++;
+    }
+    auto fim = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(fim - inicio).count() / consultas.size();
+}
+
+// ISBN-13 aleatório; o prefixo distingue os cadastrados (978) dos ausentes (979).
+string sortearIsbn(mt19937_64& gerador, const char* prefixo) {
+    return prefixo + to_string(1000000000ULL + gerador() % 9000000000ULL);
+}
+
+void imprimir(const char* nome, double ns, size_t encontrados) {
+    cout << nome << setw(8) << fixed << setprecision(1) << ns << " ns/busca (" << encontrados << " encontrados)\n";
+}
+
+// Com a BST e o índice hash em memória.
+void compararCompleto(size_t numeroLivros, size_t numeroBuscas) {
+    mt19937_64 gerador(42);
+    vector<string> isbns(numeroLivros);
+    for (auto& isbn : isbns) {
+        isbn = sortearIsbn(gerador, "978");
+    }
+
+    // Inseridos em ordem aleatória para a BST não degenerar.
+    BST livros;
+    IndiceLivros indice;
+    for (const auto& isbn : isbns) {
+        livros.root = livros.insert(livros.root, Livro(isbn, "Titulo", "Autor", 100));
+    }
+
+    auto inicioCongelar = chrono::steady_clock::now();
+    CatalogoCongelado congelado;
+    congelado.congelar(BSTIterator(livros.root));
+    auto fimCongelar = chrono::steady_clock::now();
+    livros.attachIndex(&indice);
+
+    // Metade das buscas acerta, metade procura chaves ausentes.
+    vector<string> consultas(numeroBuscas);
+    for (size_t i = 0; i < numeroBuscas; i++) {
+        consultas[i] = (i % 2 == 0) ? isbns[gerador() % numeroLivros] : sortearIsbn(gerador, "979");
+    }
+
+    size_t encontradosArvore, encontradosHash, encontradosCongelado, encontradosSistema;
+    double arvore = medir(consultas, [&](const string& isbn) { return livros.search(livros.root, isbn) != nullptr; }, encontradosArvore);
+    double hash = medir(consultas, [&](const string& isbn) { return indice.buscar(isbn) != nullptr; }, encontradosHash);
+    double eytzinger = medir(consultas, [&](const string& isbn) { return congelado.buscar(isbn) != nullptr; }, encontradosCongelado);
+
+    // O caminho do sistema: as primeiras buscas passam pelo hash até a cópia ser
+    // compilada; o tempo de congelar entra na média.
+    CatalogoCongelado copiaDoSistema;
+    livros.attachFrozen(&copiaDoSistema);
+    double sistema = medir(consultas, [&](const string& isbn) { return livros.lookup(isbn) != nullptr; }, encontradosSistema);
+
+    cout << "Livros: " << congelado.tamanho() << ", buscas: " << numeroBuscas << "\n";
+    cout << "Congelar: " << fixed << setprecision(1)
+         << chrono::duration<double, milli>(fimCongelar - inicioCongelar).count() << " ms\n";
+    imprimir("BST (ponteiros):     ", arvore, encontradosArvore);
+    imprimir("Indice hash:         ", hash, encontradosHash);
+    imprimir("Congelado Eytzinger: ", eytzinger, encontradosCongelado);
+    imprimir("BST::lookup:         ", sistema, encontradosSistema);
+}
+
+// Só as chaves: o catálogo congelado contra uma busca binária no vetor ordenado.
+void compararSoChaves(size_t numeroLivros, size_t numeroBuscas) {
+    mt19937_64 gerador(42);
+    vector<uint64_t> codigos(numeroLivros);
+    for (auto& codigo : codigos) {
+        CatalogoCongelado::codificar(sortearIsbn(gerador, "978"), codigo);
+    }
+    sort(codigos.begin(), codigos.end());
+    codigos.erase(unique(codigos.begin(), codigos.end()), codigos.end());
+
+    vector<string> consultas(numeroBuscas);
+    for (size_t i = 0; i < numeroBuscas; i++) {
+        if (i % 2 == 0) {
+            // Decodifica uma chave cadastrada de volta para o ISBN.
+            uint64_t codigo = codigos[gerador() % codigos.size()];
+            string isbn;
+            for (int d = 0; d < 18; d++, codigo /= 11) {
+                if (codigo % 11) isbn.push_back('0' + codigo % 11 - 1);
+            }
+            consultas[i].assign(isbn.rbegin(), isbn.rend());
+        } else {
+            consultas[i] = sortearIsbn(gerador, "979");
+        }
+    }
+
+    auto inicioCongelar = chrono::steady_clock::now();
+    CatalogoCongelado congelado;
+    congelado.congelarCodigos(codigos, {});
+    auto fimCongelar = chrono::steady_clock::now();
+
+    size_t encontradosBinaria, encontradosCongelado;
+    double binaria = medir(consultas, [&](const string& isbn) {
+        uint64_t alvo = 0;
+        CatalogoCongelado::codificar(isbn, alvo);
+        return binary_search(codigos.begin(), codigos.end(), alvo);
+    }, encontradosBinaria);
+    double eytzinger = medir(consultas, [&](const string& isbn) { return congelado.posicao(isbn) != 0; }, encontradosCongelado);
+
+    cout << "Livros: " << congelado.tamanho() << " (somente chaves), buscas: " << numeroBuscas << "\n";
+    cout << "Congelar: " << fixed << setprecision(1)
+         << chrono::duration<double, milli>(fimCongelar - inicioCongelar).count() << " ms\n";
+    imprimir("Busca binaria:       ", binaria, encontradosBinaria);
+    imprimir("Congelado Eytzinger: ", eytzinger, encontradosCongelado);
+}
+
+int main(int argc, char* argv[]) {
+    size_t numeroLivros = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t numeroBuscas = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    size_t limiteArvore = argc > 3 ? strtoull(argv[3], nullptr, 10) : 4000000;
+    if (numeroLivros == 0 || numeroBuscas == 0) {
+        cerr << "Use numeros de livros e de buscas positivos." << endl;
+        return 1;
+    }
+
+    if (numeroLivros <= limiteArvore) {
+        compararCompleto(numeroLivros, numeroBuscas);
+    } else {
+        compararSoChaves(numeroLivros, numeroBuscas);
+    }
+    return 0;
+}
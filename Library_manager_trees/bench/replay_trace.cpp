@@ -0,0 +1,383 @@
+// Reproduz um trace gravado com "main --gravar <arquivo>" sobre uma biblioteca vazia e
+// mede a vazão e a latência de cada tipo de operação. Se o trace terminar com o estado
+// final gravado, confere se a reprodução chegou ao mesmo estado e sai com erro se não.
+// Uso: replay_trace <arquivo> [--velocidade original|max|N] [--threads N] [--fragmentos N]
+//   original: respeita os intervalos gravados; N: N vezes mais rápido; max: sem pausas.
+//   --fragmentos reproduz sobre uma BibliotecaFragmentada com N fragmentos.
+// Compilar a partir de Library_manager_trees: g++ -O2 -pthread -I. bench/replay_trace.cpp -o replay_trace
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include "Biblioteca.h"
+#include "BibliotecaFragmentada.h"
+#include "Trace.h"
+#include "Relatorio.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Relogio;
+
+// Destino dos relatórios exportados durante a reprodução: o custo de montar o texto
+// entra na medida, mas nada é gravado em disco.
+FILE* descarte() {
+    static FILE* arquivo = fopen("/dev/null", "w");
+    return arquivo;
+}
+
+// Converte um argumento do trace em int. Retorna false se o texto não for um número
+// inteiro completo ou não couber em int.
+bool lerInteiro(const string& texto, int& valor) {
+    char* fim;
+    errno = 0;
+    long numero = strtol(texto.c_str(), &fim, 10);
+    if (texto.empty() || *fim || errno == ERANGE || numero < INT_MIN || numero > INT_MAX) return false;
+    valor = (int)numero;
+    return true;
+}
+
+// Executa uma operação do trace na biblioteca, única ou fragmentada. Retorna false só
+// quando a operação é o estado final gravado e ele difere do estado reproduzido.
+template <typename Acervo>
+bool executar(Acervo& biblioteca, const OperacaoTrace& operacao) {
+    const vector<string>& a = operacao.argumentos;
+    int numero, segundo;
+    switch (operacao.tipo) {
+        case OP_CADASTRAR_LIVRO:
+            if (a.size() == 4 && lerInteiro(a[3], numero) && numero > 0) biblioteca.cadastrarLivro(Livro(a[0], a[1], a[2], numero));
+            break;
+        case OP_REMOVER_LIVRO:
+            if (a.size() == 1) biblioteca.removerLivro(a[0]);
+            break;
+        case OP_BUSCAR_LIVRO:
+            if (a.size() == 1) { Livro livro; biblioteca.buscarLivro(a[0], livro); }
+            break;
+        case OP_CADASTRAR_USUARIO:
+            if (a.size() == 3) biblioteca.cadastrarUsuario(Usuario(a[0], a[1], a[2]));
+            break;
+        case OP_REMOVER_USUARIO:
+            if (a.size() == 1) biblioteca.removerUsuario(a[0]);
+            break;
+        case OP_BUSCAR_USUARIO:
+            if (a.size() == 1) { Usuario usuario; biblioteca.buscarUsuario(a[0], usuario); }
+            break;
+        case OP_REGISTRAR_EMPRESTIMO:
+            if (a.size() >= 3) {
+                string falha;
+                biblioteca.registrarEmprestimo(a[0], a[1], a[2], vector<string>(a.begin() + 3, a.end()), falha);
+            }
+            break;
+        case OP_DEVOLVER_LIVRO:
+            if (a.size() == 2) biblioteca.devolverLivro(a[0], a[1]);
+            break;
+        case OP_DEVOLVER_LOTE:
+            if (a.size() >= 1) biblioteca.devolverLivros(vector<string>(a.begin() + 1, a.end()), a[0]);
+            break;
+        case OP_EXPURGAR_HISTORICO:
+            if (a.size() == 1) biblioteca.expurgarHistorico(a[0]);
+            break;
+        case OP_LISTAR_LIVROS:
+            if (a.size() == 3) biblioteca.listarLivros(a[0], strtoull(a[1].c_str(), nullptr, 10), a[2] == "1");
+            break;
+        case OP_LISTAR_USUARIOS:
+            if (a.size() == 2) biblioteca.listarUsuarios(a[0], strtoull(a[1].c_str(), nullptr, 10));
+            break;
+        case OP_LISTAR_EMPRESTIMOS:
+            if (a.size() == 2) biblioteca.listarEmprestimos(a[0], strtoull(a[1].c_str(), nullptr, 10));
+            break;
+        case OP_EXPORTAR_RELATORIO:
+            if (a.size() == 1 && lerInteiro(a[0], numero) && descarte()) {
+                SaidaBufferizada saida(descarte());
+                Relatorio relatorio(saida, FORMATO_TEXTO);
+                biblioteca.exportarRelatorio(numero, relatorio);
+            }
+            break;
+        case OP_ESTATISTICAS:
+            if (a.size() == 2 && lerInteiro(a[0], numero) && lerInteiro(a[1], segundo) && numero > 0 && segundo > 0) {
+                biblioteca.estatisticas(numero, segundo);
+            }
+            break;
+        case OP_CONSULTAR_HISTORICO:
+            if (a.size() == 1) { vector<Emprestimo> encontrados; biblioteca.consultarHistorico(a[0], encontrados); }
+            break;
+        case OP_COMPACTAR:
+            biblioteca.compactar();
+            break;
+        case OP_ESTADO_FINAL:
+            return biblioteca.resumo().argumentos() == a;
+        default:
+            break;
+    }
+    return true;
+}
+
+// Operações que leem ou alteram o acervo inteiro. Elas separam o trace em épocas:
+// esperam todas as operações anteriores terminarem, e as seguintes esperam por elas.
+bool operacaoGlobal(TipoOperacao tipo) {
+    switch (tipo) {
+        case OP_EXPURGAR_HISTORICO:
+        case OP_LISTAR_LIVROS:
+        case OP_LISTAR_USUARIOS:
+        case OP_LISTAR_EMPRESTIMOS:
+        case OP_EXPORTAR_RELATORIO:
+        case OP_ESTATISTICAS:
+        case OP_COMPACTAR:
+        case OP_ESTADO_FINAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Chaves que a operação lê ou altera: "L" seguido do ISBN para livros e empréstimos,
+// "U" seguido do ID para usuários. Um empréstimo toca o usuário e todos os livros.
+vector<string> chavesDaOperacao(const OperacaoTrace& operacao) {
+    const vector<string>& a = operacao.argumentos;
+    vector<string> chaves;
+    switch (operacao.tipo) {
+        case OP_CADASTRAR_LIVRO:
+        case OP_REMOVER_LIVRO:
+        case OP_BUSCAR_LIVRO:
+        case OP_DEVOLVER_LIVRO:
+        case OP_CONSULTAR_HISTORICO:
+            if (!a.empty()) chaves.push_back("L" + a[0]);
+            break;
+        case OP_CADASTRAR_USUARIO:
+        case OP_REMOVER_USUARIO:
+        case OP_BUSCAR_USUARIO:
+            if (!a.empty()) chaves.push_back("U" + a[0]);
+            break;
+        case OP_REGISTRAR_EMPRESTIMO:
+            if (!a.empty()) chaves.push_back("U" + a[0]);
+            for (size_t i = 3; i < a.size(); i++) chaves.push_back("L" + a[i]);
+            break;
+        case OP_DEVOLVER_LOTE:
+            for (size_t i = 1; i < a.size(); i++) chaves.push_back("L" + a[i]);
+            break;
+        default:
+            break;
+    }
+    sort(chaves.begin(), chaves.end());
+    chaves.erase(unique(chaves.begin(), chaves.end()), chaves.end());
+    return chaves;
+}
+
+// Operação do trace com o que ela precisa esperar. Cada chave recebe um número de
+// ordem por operação que a toca; a operação só começa quando todas as anteriores em
+// cada uma das suas chaves terminaram, o que reproduz a ordem gravada entre operações
+// dependentes qualquer que seja a thread de cada uma.
+struct Passo {
+    OperacaoTrace operacao;
+    vector<pair<size_t, uint32_t>> dependencias;  // Chave e número de ordem nela.
+    size_t epoca;                                 // Operações globais anteriores.
+    bool global;
+};
+
+// Estado compartilhado das dependências durante a reprodução.
+struct Andamento {
+    unique_ptr<atomic<uint32_t>[]> porChave;   // Operações concluídas em cada chave.
+    unique_ptr<atomic<size_t>[]> porEpoca;     // Operações não globais concluídas em cada época.
+    vector<size_t> totalPorEpoca;              // Operações não globais de cada época.
+    atomic<size_t> epocasConcluidas;           // Operações globais concluídas.
+
+    Andamento(size_t chaves, const vector<size_t>& total)
+        : porChave(new atomic<uint32_t>[chaves]()), porEpoca(new atomic<size_t>[total.size()]()),
+          totalPorEpoca(total), epocasConcluidas(0) {}
+
+    bool pronto(const Passo& passo) const {
+        if (passo.global) {
+            return epocasConcluidas.load() == passo.epoca &&
+                   porEpoca[passo.epoca].load() == totalPorEpoca[passo.epoca];
+        }
+        if (epocasConcluidas.load() < passo.epoca) return false;
+        for (const auto& dependencia : passo.dependencias) {
+            if (porChave[dependencia.first].load() != dependencia.second) return false;
+        }
+        return true;
+    }
+
+    void concluir(const Passo& passo) {
+        if (passo.global) {
+            epocasConcluidas.store(passo.epoca + 1);
+            return;
+        }
+        for (const auto& dependencia : passo.dependencias) {
+            porChave[dependencia.first].fetch_add(1);
+        }
+        porEpoca[passo.epoca].fetch_add(1);
+    }
+};
+
+// Latência de uma operação executada, em nanossegundos.
+struct Amostra {
+    TipoOperacao tipo;
+    uint64_t latencia;
+};
+
+// Reproduz os passos de cada thread sobre a biblioteca e guarda as latências.
+// Retorna false se o estado final gravado não conferir.
+template <typename Acervo>
+bool reproduzir(Acervo& biblioteca, const vector<vector<Passo>>& porThread, Andamento& andamento,
+                double velocidade, vector<vector<Amostra>>& amostras) {
+    vector<thread> threads;
+    atomic<bool> confere(true);
+    Relogio::time_point inicio = Relogio::now();
+    for (size_t t = 0; t < porThread.size(); t++) {
+        threads.emplace_back([&, t]() {
+            amostras[t].reserve(porThread[t].size());
+            for (const auto& passo : porThread[t]) {
+                const OperacaoTrace& op = passo.operacao;
+                // Com pausas, a latência conta a partir do instante previsto, para que um
+                // atraso acumulado apareça nos percentis em vez de simplesmente adiar a carga.
+                // Sem pausas, conta a partir do momento em que as dependências terminaram.
+                Relogio::time_point previsto;
+                if (velocidade > 0) {
+                    previsto = inicio + chrono::duration_cast<Relogio::duration>(
+                                            chrono::duration<double, micro>(op.instante / velocidade));
+                    this_thread::sleep_until(previsto);
+                }
+                while (!andamento.pronto(passo)) {
+                    this_thread::yield();
+                }
+                if (velocidade == 0) previsto = Relogio::now();
+                if (!executar(biblioteca, op)) confere = false;
+                andamento.concluir(passo);
+                uint64_t latencia = chrono::duration_cast<chrono::nanoseconds>(Relogio::now() - previsto).count();
+                amostras[t].push_back(Amostra{op.tipo, latencia});
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    return confere;
+}
+
+double percentil(const vector<uint64_t>& ordenadas, double p) {
+    size_t posicao = (size_t)(p * (ordenadas.size() - 1) + 0.5);
+    return ordenadas[posicao] / 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Uso: " << argv[0] << " <arquivo> [--velocidade original|max|N] [--threads N] [--fragmentos N]" << endl;
+        return 1;
+    }
+
+    double velocidade = 1;  // Zero reproduz sem pausas.
+    unsigned numeroThreads = 1;
+    unsigned numeroFragmentos = 0;  // Zero usa uma Biblioteca simples.
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--velocidade") == 0) {
+            if (strcmp(argv[i + 1], "max") == 0) velocidade = 0;
+            else if (strcmp(argv[i + 1], "original") == 0) velocidade = 1;
+            else velocidade = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            numeroThreads = max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--fragmentos") == 0) {
+            numeroFragmentos = max(1, atoi(argv[i + 1]));
+        }
+    }
+    if (velocidade < 0) {
+        cerr << "Velocidade invalida." << endl;
+        return 1;
+    }
+
+    LeitorTrace leitor;
+    if (!leitor.abrir(argv[1])) {
+        cerr << "Trace invalido: " << argv[1] << endl;
+        return 1;
+    }
+
+    // Numera as operações de cada chave e de cada época. A thread de cada operação é
+    // escolhida pela sua primeira chave, para que operações sobre o mesmo item tendam a
+    // cair na mesma thread e esperem menos; as globais ficam com a thread 0. A ordem
+    // entre operações dependentes não depende dessa escolha.
+    vector<vector<Passo>> porThread(numeroThreads);
+    unordered_map<string, size_t> idChave;
+    vector<uint32_t> vistasPorChave;
+    vector<size_t> totalPorEpoca(1, 0);
+    bool temEstadoFinal = false;
+    Passo passo;
+    size_t totalOperacoes = 0;
+    while (leitor.proxima(passo.operacao)) {
+        passo.global = operacaoGlobal(passo.operacao.tipo);
+        passo.epoca = totalPorEpoca.size() - 1;
+        passo.dependencias.clear();
+        size_t destino = 0;
+        if (passo.global) {
+            totalPorEpoca.push_back(0);
+        } else {
+            vector<string> chaves = chavesDaOperacao(passo.operacao);
+            for (const auto& chave : chaves) {
+                auto it = idChave.emplace(chave, vistasPorChave.size()).first;
+                if (it->second == vistasPorChave.size()) vistasPorChave.push_back(0);
+                passo.dependencias.push_back(make_pair(it->second, vistasPorChave[it->second]++));
+            }
+            if (!chaves.empty()) destino = hash<string>()(chaves[0]) % numeroThreads;
+            totalPorEpoca[passo.epoca]++;
+        }
+        if (passo.operacao.tipo == OP_ESTADO_FINAL) temEstadoFinal = true;
+        porThread[destino].push_back(passo);
+        totalOperacoes++;
+    }
+    if (totalOperacoes == 0) {
+        cerr << "O trace nao tem operacoes." << endl;
+        return 1;
+    }
+
+    vector<vector<Amostra>> amostras(numeroThreads);
+    Andamento andamento(vistasPorChave.size(), totalPorEpoca);
+    Relogio::time_point inicio = Relogio::now();
+    bool confere;
+    if (numeroFragmentos > 0) {
+        BibliotecaFragmentada biblioteca(numeroFragmentos);
+        confere = reproduzir(biblioteca, porThread, andamento, velocidade, amostras);
+    } else {
+        Biblioteca biblioteca;
+        confere = reproduzir(biblioteca, porThread, andamento, velocidade, amostras);
+    }
+    double segundos = chrono::duration<double>(Relogio::now() - inicio).count();
+
+    vector<vector<uint64_t>> latencias(OP_TOTAL);
+    for (const auto& lista : amostras) {
+        for (const auto& amostra : lista) {
+            latencias[amostra.tipo].push_back(amostra.latencia);
+        }
+    }
+
+    cout << "Operacoes: " << totalOperacoes << ", threads: " << numeroThreads
+         << ", fragmentos: " << max(1u, numeroFragmentos) << ", velocidade: ";
+    if (velocidade > 0) cout << velocidade << "x\n"; else cout << "max\n";
+    cout << fixed << setprecision(2);
+    cout << "Tempo: " << segundos << " s, vazao: " << totalOperacoes / segundos << " op/s\n\n";
+    cout << left << setw(22) << "Operacao" << right << setw(10) << "Qtde"
+         << setw(12) << "p50 (us)" << setw(12) << "p95 (us)" << setw(12) << "p99 (us)" << setw(12) << "max (us)" << "\n";
+    for (int tipo = 1; tipo < OP_TOTAL; tipo++) {
+        vector<uint64_t>& lista = latencias[tipo];
+        if (lista.empty()) continue;
+        sort(lista.begin(), lista.end());
+        cout << left << setw(22) << nomeOperacao(tipo) << right << setw(10) << lista.size()
+             << setw(12) << percentil(lista, 0.50) << setw(12) << percentil(lista, 0.95)
+             << setw(12) << percentil(lista, 0.99) << setw(12) << lista.back() / 1000.0 << "\n";
+    }
+
+    if (!temEstadoFinal) {
+        cout << "\nO trace nao tem o estado final gravado; nada a conferir.\n";
+    } else if (confere) {
+        cout << "\nEstado final: igual ao gravado.\n";
+    } else {
+        cout << "\nEstado final: DIFERENTE do gravado.\n";
+        return 1;
+    }
+    return 0;
+}
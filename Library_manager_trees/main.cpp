@@ -5,15 +5,19 @@
 #include <chrono>//validar o tempo de emprestimo
 #include <iomanip>// é usado para formatação de saída
 #include <sstream>// é usado para converter entre uma string e um número.
-#include "Livro.h"
-#include "Usuario.h"
-#include "Emprestimo.h"
+#include <cstring>
+#include "Biblioteca.h"
+#include "BibliotecaFragmentada.h"
+#include "Relatorio.h"
+#include "Compactacao.h"
+#include "Trace.h"
 
 using namespace std;
 
-BST livros;
-AVL usuarios;
-BTree emprestimos;
+// Árvores, índices e histórico, em um ou mais fragmentos (--fragmentos N); as operações
+// do menu passam por aqui. Criada em main, depois de lidas as opções.
+BibliotecaFragmentada* biblioteca;
+GravadorTrace gravador; // Trace das operações, ativo quando o programa recebe --gravar.
 
 void pausarTela() {
     cout << "Pressione Enter para continuar...";
@@ -21,15 +25,15 @@ void pausarTela() {
     cin.get();
 }
 
-bool livroEmprestado(const string& isbn) {
-    vector<Emprestimo> todosEmprestimos;
-    emprestimos.inorder(emprestimos.root, todosEmprestimos);
-    for (const auto& emprestimo : todosEmprestimos) {
-        if (emprestimo.tituloLivro == isbn) {
-            return true;
-        }
-    }
-    return false;
+// Como pausarTela, para quando a linha anterior já foi consumida com getline.
+void aguardarEnter() {
+    cout << "Pressione Enter para continuar...";
+    cin.get();
+}
+
+// Limpa o terminal com sequências ANSI, sem abrir um shell a cada iteração do menu.
+void limparTela() {
+    cout << "\033[2J\033[H" << flush;
 }
 
 bool validarISBN(const string& isbn) {
@@ -37,27 +41,25 @@ bool validarISBN(const string& isbn) {
 }
 
 bool livroExiste(const string& isbn) {
-    Livro* livro = livros.search(livros.root, isbn);
-    return livro != nullptr;
+    return biblioteca->livroCadastrado(isbn);
 }
 
 bool usuarioExiste(const string& id) {
-    Usuario* usuario = usuarios.search(usuarios.root, id);
-    return usuario != nullptr;
+    return biblioteca->usuarioCadastrado(id);
 }
 
-bool validarDataDevolucao(const string& dataEmprestimo, const string& dataDevolucao) {
-    tm tmEmprestimo = {};
-    tm tmDevolucao = {};
-
-    istringstream ssEmprestimo(dataEmprestimo);
-    istringstream ssDevolucao(dataDevolucao);
-
-    ssEmprestimo >> get_time(&tmEmprestimo, "%d-%m-%Y");
-    ssDevolucao >> get_time(&tmDevolucao, "%d-%m-%Y");
+// Data de hoje no formato dd-mm-aaaa, usada para carimbar as devoluções.
+string dataDeHoje() {
+    time_t agora = chrono::system_clock::to_time_t(chrono::system_clock::now());
+    tm tmAgora = *localtime(&agora);
+    ostringstream ssData;
+    ssData << put_time(&tmAgora, "%d-%m-%Y");
+    return ssData.str();
+}
 
-    auto timeEmprestimo = mktime(&tmEmprestimo);
-    auto timeDevolucao = mktime(&tmDevolucao);
+bool validarDataDevolucao(const string& dataEmprestimo, const string& dataDevolucao) {
+    auto timeEmprestimo = converterData(dataEmprestimo);
+    auto timeDevolucao = converterData(dataDevolucao);
 
     return difftime(timeDevolucao, timeEmprestimo) > 0;
 }
@@ -87,7 +89,7 @@ void cadastrarLivro() {
     }
 
     Livro livro(isbn, titulo, autor, numeroPaginas);
-    livros.root = livros.insert(livros.root, livro);
+    biblioteca->cadastrarLivro(livro);
     cout << "Livro cadastrado com sucesso!" << endl;
     pausarTela();
 }
@@ -97,13 +99,12 @@ void removerLivro() {
     cout << "ISBN do livro a ser removido: ";
     cin >> isbn;
 
-    if (!livroExiste(isbn)) {
+    if (!biblioteca->removerLivro(isbn)) {
         cout << "Livro nao encontrado!" << endl;
         pausarTela();
         return;
     }
 
-    livros.root = livros.remove(livros.root, isbn);
     cout << "Livro removido com sucesso!" << endl;
     pausarTela();
 }
@@ -113,11 +114,11 @@ void buscarLivro() {
     cout << "ISBN do livro: ";
     cin >> isbn;
 
-    Livro* livro = livros.search(livros.root, isbn);
-    if (livro) {
-        cout << "Titulo: " << livro->titulo << endl;
-        cout << "Autor: " << livro->autor << endl;
-        cout << "Numero de Paginas: " << livro->numeroPaginas << endl;
+    Livro livro;
+    if (biblioteca->buscarLivro(isbn, livro)) {
+        cout << "Titulo: " << livro.titulo << endl;
+        cout << "Autor: " << livro.autor << endl;
+        cout << "Numero de Paginas: " << livro.numeroPaginas << endl;
     } else {
         cout << "Livro nao encontrado!" << endl;
     }
@@ -146,7 +147,7 @@ void cadastrarUsuario() {
     getline(cin, contato);
 
     Usuario usuario(id, nome, contato);
-    usuarios.root = usuarios.insert(usuarios.root, usuario);
+    biblioteca->cadastrarUsuario(usuario);
     cout << "Usuario cadastrado com sucesso!" << endl;
     pausarTela();
 }
@@ -156,13 +157,12 @@ void removerUsuario() {
     cout << "ID do usuario a ser removido: ";
     cin >> id;
 
-    if (!usuarioExiste(id)) {
+    if (!biblioteca->removerUsuario(id)) {
         cout << "Usuario nao encontrado!" << endl;
         pausarTela();
         return;
     }
 
-    usuarios.root = usuarios.remove(usuarios.root, id);
     cout << "Usuario removido com sucesso!" << endl;
     pausarTela();
 }
@@ -172,10 +172,10 @@ void buscarUsuario() {
     cout << "ID do usuario: ";
     cin >> id;
 
-    Usuario* usuario = usuarios.search(usuarios.root, id);
-    if (usuario) {
-        cout << "Nome: " << usuario->nome << endl;
-        cout << "Contato: " << usuario->contato << endl;
+    Usuario usuario;
+    if (biblioteca->buscarUsuario(id, usuario)) {
+        cout << "Nome: " << usuario.nome << endl;
+        cout << "Contato: " << usuario.contato << endl;
     } else {
         cout << "Usuario nao encontrado!" << endl;
     }
@@ -186,6 +186,37 @@ bool validarData(const string& data) {
     return regex_match(data, regex("^\\d{2}-\\d{2}-\\d{4}$"));
 }
 
+void lerDatasEmprestimo(string& dataEmprestimo, string& dataDevolucao) {
+    do {
+        cout << "Data de Emprestimo (dd-mm-aaaa): ";
+        cin >> dataEmprestimo;
+        if (!validarData(dataEmprestimo)) {
+            cout << "Data invalida. Use o formato dd-mm-aaaa. Tente novamente." << endl;
+        }
+    } while (!validarData(dataEmprestimo));
+
+    do {
+        cout << "Data de Devolucao (dd-mm-aaaa): ";
+        cin >> dataDevolucao;
+        if (!validarData(dataDevolucao) || !validarDataDevolucao(dataEmprestimo, dataDevolucao)) {
+            cout << "Data de devolucao invalida. Deve ser posterior a data de emprestimo e no formato dd-mm-aaaa. Tente novamente." << endl;
+        }
+    } while (!validarData(dataDevolucao) || !validarDataDevolucao(dataEmprestimo, dataDevolucao));
+}
+
+bool informarResultado(ResultadoTransacao resultado, const string& falha) {
+    switch (resultado) {
+        case TRANSACAO_CONFIRMADA: cout << "Emprestimo registrado com sucesso!" << endl; return true;
+        case TRANSACAO_VAZIA: cout << "Nenhum livro informado." << endl; break;
+        case USUARIO_INEXISTENTE: cout << "Usuario nao encontrado!" << endl; break;
+        case LIVRO_INEXISTENTE: cout << "Livro " << falha << " nao encontrado!" << endl; break;
+        case LIVRO_JA_EMPRESTADO: cout << "Livro " << falha << " ja esta emprestado!" << endl; break;
+        case LIVRO_REPETIDO: cout << "Livro " << falha << " informado mais de uma vez!" << endl; break;
+    }
+    cout << "Nenhum emprestimo foi registrado." << endl;
+    return false;
+}
+
 void registrarEmprestimo() {
     string isbnLivro, idUsuario, dataEmprestimo, dataDevolucao;
 
@@ -207,63 +238,306 @@ void registrarEmprestimo() {
         return;
     }
 
-    do {
-        cout << "Data de Emprestimo (dd-mm-aaaa): ";
-        cin >> dataEmprestimo;
-        if (!validarData(dataEmprestimo)) {
-            cout << "Data invalida. Use o formato dd-mm-aaaa. Tente novamente." << endl;
-        }
-    } while (!validarData(dataEmprestimo));
-
-    do {
-        cout << "Data de Devolucao (dd-mm-aaaa): ";
-        cin >> dataDevolucao;
-        if (!validarData(dataDevolucao) || !validarDataDevolucao(dataEmprestimo, dataDevolucao)) {
-            cout << "Data de devolucao invalida. Deve ser posterior a data de emprestimo e no formato dd-mm-aaaa. Tente novamente." << endl;
-        }
-    } while (!validarData(dataDevolucao) || !validarDataDevolucao(dataEmprestimo, dataDevolucao));
+    lerDatasEmprestimo(dataEmprestimo, dataDevolucao);
 
-    Emprestimo emprestimo(isbnLivro, idUsuario, dataEmprestimo, dataDevolucao);
-    emprestimos.insert(emprestimo);
-    cout << "Emprestimo registrado com sucesso!" << endl;
+    string falha;
+    ResultadoTransacao resultado = biblioteca->registrarEmprestimo(idUsuario, dataEmprestimo, dataDevolucao, {isbnLivro}, falha);
+    informarResultado(resultado, falha);
     pausarTela();
 }
 
+void registrarEmprestimoLote() {
+    string idUsuario, dataEmprestimo, dataDevolucao, linha;
+
+    cout << "ID do Usuario: ";
+    cin >> idUsuario;
+    if (!usuarioExiste(idUsuario)) {
+        cout << "Usuario nao encontrado!" << endl;
+        pausarTela();
+        return;
+    }
+
+    lerDatasEmprestimo(dataEmprestimo, dataDevolucao);
+
+    cout << "ISBNs dos Livros (separados por espaco): ";
+    cin.ignore();
+    getline(cin, linha);
+    vector<string> isbns;
+    istringstream entrada(linha);
+    string isbn;
+    while (entrada >> isbn) {
+        isbns.push_back(isbn);
+    }
+
+    string falha;
+    if (informarResultado(biblioteca->registrarEmprestimo(idUsuario, dataEmprestimo, dataDevolucao, isbns, falha), falha)) {
+        cout << isbns.size() << " livro(s) emprestado(s)." << endl;
+    }
+    aguardarEnter();
+}
+
 void devolverLivro() {
     string isbnLivro;
     cout << "ISBN do Livro: ";
     cin.ignore();
     getline(cin, isbnLivro);
 
-    if (!livroExiste(isbnLivro)) {
+    if (!biblioteca->devolverLivro(isbnLivro, dataDeHoje())) {
         cout << "Livro nao encontrado!" << endl;
         pausarTela();
         return;
     }
 
-    emprestimos.root = emprestimos.remove(emprestimos.root, isbnLivro);
     cout << "Livro devolvido com sucesso!" << endl;
     pausarTela();
 }
 
+void devolverLivrosLote() {
+    string linha;
+    cout << "ISBNs dos Livros devolvidos (separados por espaco): ";
+    cin.ignore();
+    getline(cin, linha);
+
+    vector<string> isbns;
+    istringstream entrada(linha);
+    string isbn;
+    while (entrada >> isbn) {
+        isbns.push_back(isbn);
+    }
+
+    size_t quantidade = biblioteca->devolverLivros(isbns, dataDeHoje());
+    cout << quantidade << " livro(s) devolvido(s) com sucesso!" << endl;
+    aguardarEnter();
+}
+
+void expurgarEmprestimos() {
+    string data;
+    do {
+        cout << "Remover do historico emprestimos devolvidos antes de (dd-mm-aaaa): ";
+        cin >> data;
+        if (!validarData(data)) {
+            cout << "Data invalida. Use o formato dd-mm-aaaa. Tente novamente." << endl;
+        }
+    } while (!validarData(data));
+
+    size_t quantidade = biblioteca->expurgarHistorico(data);
+    cout << quantidade << " emprestimo(s) encerrado(s) removido(s) do historico." << endl;
+    pausarTela();
+}
+
+// Lista os registros em páginas de texto na tela, aguardando o usuário entre uma
+// página e outra. Cada página é pedida à biblioteca a partir da chave em que a
+// anterior parou, com um registro a mais para saber se ainda há o que mostrar.
+// Retorna quantos registros foram exibidos.
+template <typename Pagina, typename Chave>
+size_t listarPaginado(Pagina pagina, Chave chave) {
+    const size_t tamanhoPagina = 20;
+    SaidaBufferizada saida(stdout);
+    Relatorio relatorio(saida, FORMATO_TEXTO);
+
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    string inicio;
+    for (;;) {
+        auto registros = pagina(inicio, tamanhoPagina + 1);
+        for (size_t i = 0; i < registros.size() && i < tamanhoPagina; i++) {
+            relatorio.registro(registros[i]);
+        }
+        if (registros.size() <= tamanhoPagina) break;
+        inicio = chave(registros[tamanhoPagina]);
+        saida << "-- Enter para a proxima pagina, q para sair --";
+        saida.descarregar();
+        string resposta;
+        getline(cin, resposta);
+        if (resposta == "q") break;
+    }
+    saida.descarregar();
+    return relatorio.total();
+}
+
 void listarLivros() {
-    vector<Livro> todosLivros;
-    livros.inorder(livros.root, todosLivros);
-    for (const auto& livro : todosLivros) {
-        if (!livroEmprestado(livro.ISBN)) {
-            cout << "ISBN: " << livro.ISBN << ", Titulo: " << livro.titulo << ", Autor: " << livro.autor << ", Paginas: " << livro.numeroPaginas << endl;
+    size_t total = listarPaginado([](const string& inicio, size_t limite) {
+        return biblioteca->listarLivros(inicio, limite, true);
+    }, [](const Livro& livro) { return livro.ISBN; });
+    if (total == 0) {
+        cout << "Nao ha livros disponiveis no momento." << endl;
+    }
+    aguardarEnter();
+}
+
+void listarUsuarios() {
+    size_t total = listarPaginado([](const string& inicio, size_t limite) {
+        return biblioteca->listarUsuarios(inicio, limite);
+    }, [](const Usuario& usuario) { return usuario.id; });
+    if (total == 0) {
+        cout << "Nenhum usuario cadastrado." << endl;
+    }
+    aguardarEnter();
+}
+
+void listarEmprestimos() {
+    size_t total = listarPaginado([](const string& inicio, size_t limite) {
+        return biblioteca->listarEmprestimos(inicio, limite);
+    }, [](const Emprestimo& emprestimo) { return emprestimo.tituloLivro; });
+    if (total == 0) {
+        cout << "Nenhum emprestimo registrado." << endl;
+    }
+    aguardarEnter();
+}
+
+void consultarHistorico() {
+    string isbn;
+    cout << "ISBN do Livro: ";
+    cin >> isbn;
+
+    vector<Emprestimo> encontrados;
+    biblioteca->consultarHistorico(isbn, encontrados);
+    {
+        SaidaBufferizada saida(stdout);
+        Relatorio relatorio(saida, FORMATO_TEXTO);
+        for (const auto& emprestimo : encontrados) {
+            relatorio.registro(emprestimo);
+        }
+    }
+    if (encontrados.empty()) {
+        cout << "Nenhum emprestimo arquivado para este livro." << endl;
+    }
+    size_t arquivados, bytes;
+    biblioteca->tamanhoHistorico(arquivados, bytes);
+    cout << "Historico: " << arquivados << " emprestimo(s) arquivado(s), " << bytes << " bytes comprimidos." << endl;
+    pausarTela();
+}
+
+void exibirMetricas(const char* nome, const MetricasArvore& antes, const MetricasArvore& depois) {
+    cout << nome << ":\n" << fixed << setprecision(2);
+    cout << "  Nos:                 " << setw(10) << antes.nos << " -> " << depois.nos << "\n";
+    cout << "  Altura (minima " << setw(3) << depois.alturaMinima << "): " << setw(10) << antes.altura << " -> " << depois.altura << "\n";
+    cout << "  Profundidade media:  " << setw(10) << antes.profundidadeMedia << " -> " << depois.profundidadeMedia << "\n";
+    cout << "  Ocupacao dos nos:    " << setw(10) << antes.ocupacao << " -> " << depois.ocupacao << "\n";
+    cout << "  Nos subocupados:     " << setw(10) << antes.nosSubocupados << " -> " << depois.nosSubocupados << "\n";
+    cout << "  Ligacoes distantes:  " << setw(10) << antes.ligacoesDistantes << " -> " << depois.ligacoesDistantes << "\n";
+}
+
+void compactarArvores() {
+    vector<pair<MetricasArvore, MetricasArvore>> metricas = biblioteca->compactar();
+    for (size_t f = 0; f < biblioteca->tamanho(); f++) {
+        if (biblioteca->tamanho() > 1) cout << "Fragmento " << f << ":\n";
+        exibirMetricas("Livros (BST)", metricas[3 * f].first, metricas[3 * f].second);
+        exibirMetricas("Usuarios (AVL)", metricas[3 * f + 1].first, metricas[3 * f + 1].second);
+        exibirMetricas("Emprestimos (Arvore B)", metricas[3 * f + 2].first, metricas[3 * f + 2].second);
+    }
+
+    cout << endl;
+    pausarTela();
+}
+
+void exportarRelatorio() {
+    int tipo, formato;
+    string arquivo;
+
+    cout << "Relatorio (1. Livros, 2. Usuarios, 3. Emprestimos): ";
+    cin >> tipo;
+    cout << "Formato (1. Texto, 2. CSV, 3. JSON): ";
+    cin >> formato;
+    if (cin.fail() || tipo < 1 || tipo > 3 || formato < 1 || formato > 3) {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Opcao invalida!" << endl;
+        aguardarEnter();
+        return;
+    }
+    cout << "Arquivo de destino (- para a tela): ";
+    cin >> arquivo;
+
+    FILE* destino = arquivo == "-" ? stdout : fopen(arquivo.c_str(), "w");
+    if (!destino) {
+        cout << "Nao foi possivel abrir o arquivo " << arquivo << "." << endl;
+        pausarTela();
+        return;
+    }
+
+    size_t total;
+    bool gravado;
+    {
+        SaidaBufferizada saida(destino);
+        Relatorio relatorio(saida, (FormatoRelatorio)(formato - 1));
+        biblioteca->exportarRelatorio(tipo, relatorio);
+        relatorio.finalizar();
+        total = relatorio.total();
+        gravado = saida.descarregar();
+    }
+    if (destino != stdout && fclose(destino) != 0) {
+        gravado = false;
+    }
+
+    if (!gravado) {
+        cout << "Erro ao gravar o relatorio em " << arquivo << "; o arquivo pode estar incompleto." << endl;
+    } else {
+        cout << total << " registro(s) exportado(s)." << endl;
+    }
+    pausarTela();
+}
+
+void exibirEstatisticas() {
+    const int largura = 100, faixas = 10;
+    EstatisticasCatalogo estatisticas = biblioteca->estatisticas(largura, faixas);
+    if (estatisticas.livros == 0) {
+        cout << "Nenhum livro cadastrado." << endl;
+        pausarTela();
+        return;
+    }
+
+    cout << "Livros: " << estatisticas.livros << "\n";
+    cout << "Total de Paginas: " << estatisticas.totalPaginas << "\n";
+    cout << "Media de Paginas: " << fixed << setprecision(1) << (double)estatisticas.totalPaginas / estatisticas.livros << "\n";
+    cout << "Menor/Maior: " << estatisticas.menorPaginas << " / " << estatisticas.maiorPaginas << "\n";
+
+    const vector<size_t>& histograma = estatisticas.histograma;
+    cout << "\nDistribuicao de Paginas:\n";
+    for (int f = 0; f < faixas; f++) {
+        if (f + 1 < faixas) {
+            cout << setw(4) << f * largura << "-" << setw(4) << (f + 1) * largura - 1;
         } else {
-            cout << "Nao ha livros disponiveis no momento." << endl;
+            cout << setw(4) << f * largura << "+    ";
         }
+        cout << ": " << histograma[f] << "\n";
     }
+
+    cout << "\nAutores com mais livros:\n";
+    for (size_t i = 0; i < estatisticas.autores.size() && i < 5; i++) {
+        cout << estatisticas.autores[i] << ": " << estatisticas.livrosAutor[i]
+             << " livro(s), " << estatisticas.paginasAutor[i] << " pagina(s)\n";
+    }
+    cout << endl;
     pausarTela();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     int opcao;
 
+    // Com --gravar <arquivo>, todas as operações da sessão vão para um trace que
+    // pode ser reproduzido depois com bench/replay_trace. Com --fragmentos N, o acervo
+    // é dividido em N bibliotecas independentes (uma por padrão).
+    const char* arquivoTrace = nullptr;
+    int numeroFragmentos = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gravar") == 0 && i + 1 < argc) {
+            arquivoTrace = argv[++i];
+        } else if (strcmp(argv[i], "--fragmentos") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            numeroFragmentos = atoi(argv[++i]);
+        } else {
+            cerr << "Uso: " << argv[0] << " [--gravar <arquivo>] [--fragmentos N]" << endl;
+            return 1;
+        }
+    }
+    if (arquivoTrace && !gravador.abrir(arquivoTrace)) {
+        cerr << "Nao foi possivel criar o trace " << arquivoTrace << "." << endl;
+        return 1;
+    }
+    BibliotecaFragmentada acervo(numeroFragmentos, arquivoTrace ? &gravador : nullptr);
+    biblioteca = &acervo;
+
     do {
-        system("cls"); // Limpar a tela no início de cada iteração do loop
+        limparTela(); // Limpar a tela no início de cada iteração do loop
         cout << "Menu:\n";
         cout << "1. Cadastrar Livro\n";
         cout << "2. Remover Livro\n";
@@ -274,6 +548,15 @@ int main() {
         cout << "7. Registrar Emprestimo\n";
         cout << "8. Devolver Livro\n";
         cout << "9. Listar Livros\n";
+        cout << "10. Registrar Emprestimo em Lote\n";
+        cout << "11. Devolver Livros em Lote\n";
+        cout << "12. Remover Emprestimos Antigos\n";
+        cout << "13. Estatisticas do Catalogo\n";
+        cout << "14. Listar Usuarios\n";
+        cout << "15. Listar Emprestimos\n";
+        cout << "16. Exportar Relatorio\n";
+        cout << "17. Historico de Emprestimos de um Livro\n";
+        cout << "18. Compactar Arvores\n";
         cout << "0. Sair\n";
         cout << "Escolha uma opcao: ";
         cin >> opcao;
@@ -295,11 +578,22 @@ int main() {
             case 7: registrarEmprestimo(); break;
             case 8: devolverLivro(); break;
             case 9: listarLivros(); break;
+            case 10: registrarEmprestimoLote(); break;
+            case 11: devolverLivrosLote(); break;
+            case 12: expurgarEmprestimos(); break;
+            case 13: exibirEstatisticas(); break;
+            case 14: listarUsuarios(); break;
+            case 15: listarEmprestimos(); break;
+            case 16: exportarRelatorio(); break;
+            case 17: consultarHistorico(); break;
+            case 18: compactarArvores(); break;
             case 0: cout << "Saindo..." << endl; break;
             default: cout << "Opcao invalida!" << endl; pausarTela(); break;
         }
 
     } while (opcao != 0);
 
+    biblioteca->registrarEstadoFinal();
+
     return 0;
 }
@@ -0,0 +1,124 @@
+// Grava um trace com uma carga aleatória e muito disputada (poucos usuários e livros,
+// empréstimos em lote, remoções, devoluções, expurgos do histórico, listagens e
+// compactação) e, no fim, o estado resultante. Serve para conferir que a reprodução
+// chega ao mesmo estado com qualquer número de threads. Com mais de uma thread de
+// gravação, as operações disputam a biblioteca como no uso real, e o trace precisa
+// registrá-las na ordem em que de fato aconteceram. Com fragmentos, a carga roda sobre
+// uma BibliotecaFragmentada, e o trace pode ser reproduzido com outro número deles:
+//   gerar_trace trace.bin [operacoes] [threads] [fragmentos]
+//   replay_trace trace.bin --velocidade max --threads 8 --fragmentos 4
+// O replay_trace sai com erro se o estado final não conferir.
+// Compilar a partir de Library_manager_trees:
+//   g++ -O2 -pthread -I. testes/gerar_trace.cpp -o gerar_trace
+#include <iostream>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include "Biblioteca.h"
+#include "BibliotecaFragmentada.h"
+#include "Trace.h"
+
+using namespace std;
+
+// Executa operacoes operações aleatórias na biblioteca, sorteadas a partir da semente.
+template <typename Acervo>
+void gerarCarga(Acervo& biblioteca, int operacoes, unsigned semente) {
+    mt19937 gerador(semente);
+    const int livros = 2000, usuarios = 200;
+    auto isbn = [&]() { return to_string(9780000000000LL + gerador() % livros); };
+    auto usuario = [&]() { return "u" + to_string(gerador() % usuarios); };
+    auto data = [&]() {
+        char texto[11];
+        snprintf(texto, sizeof(texto), "%02d-%02d-2024", (int)(gerador() % 28 + 1), (int)(gerador() % 12 + 1));
+        return string(texto);
+    };
+
+    for (int i = 0; i < operacoes; i++) {
+        unsigned sorteio = gerador() % 1000;
+        if (sorteio < 150) {
+            biblioteca.cadastrarLivro(Livro(isbn(), "Titulo " + to_string(i), "Autor " + to_string(gerador() % 50),
+                                            gerador() % 900 + 1));
+        } else if (sorteio < 200) {
+            biblioteca.removerLivro(isbn());
+        } else if (sorteio < 260) {
+            biblioteca.cadastrarUsuario(Usuario(usuario(), "Nome " + to_string(i), "contato"));
+        } else if (sorteio < 280) {
+            biblioteca.removerUsuario(usuario());
+        } else if (sorteio < 550) {
+            vector<string> isbns;
+            for (unsigned n = gerador() % 4 + 1; n > 0; n--) isbns.push_back(isbn());
+            string falha;
+            biblioteca.registrarEmprestimo(usuario(), "01-01-2024", data(), isbns, falha);
+        } else if (sorteio < 750) {
+            biblioteca.devolverLivro(isbn(), data());
+        } else if (sorteio < 800) {
+            vector<string> isbns;
+            for (unsigned n = gerador() % 8 + 1; n > 0; n--) isbns.push_back(isbn());
+            biblioteca.devolverLivros(isbns, data());
+        } else if (sorteio < 900) {
+            Livro livro;
+            biblioteca.buscarLivro(isbn(), livro);
+        } else if (sorteio < 950) {
+            Usuario encontrado;
+            biblioteca.buscarUsuario(usuario(), encontrado);
+        } else if (sorteio < 990) {
+            vector<Emprestimo> encontrados;
+            biblioteca.consultarHistorico(isbn(), encontrados);
+        } else if (sorteio < 994) {
+            biblioteca.expurgarHistorico(data());
+        } else if (sorteio < 997) {
+            biblioteca.listarLivros(isbn(), 20, true);
+        } else if (sorteio < 999) {
+            biblioteca.estatisticas(100, 10);
+        } else {
+            biblioteca.compactar();
+        }
+    }
+}
+
+// Divide a carga entre as threads, grava o estado final e o devolve.
+template <typename Acervo>
+ResumoEstado gravarCarga(Acervo& biblioteca, int operacoes, int numeroThreads) {
+    vector<thread> threads;
+    for (int t = 0; t < numeroThreads; t++) {
+        int parte = operacoes / numeroThreads + (t < operacoes % numeroThreads ? 1 : 0);
+        threads.emplace_back([&biblioteca, parte, t]() { gerarCarga(biblioteca, parte, 42 + t); });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    biblioteca.registrarEstadoFinal();
+    return biblioteca.resumo();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Uso: " << argv[0] << " <arquivo> [operacoes] [threads] [fragmentos]" << endl;
+        return 1;
+    }
+    int operacoes = argc > 2 ? atoi(argv[2]) : 200000;
+    int numeroThreads = argc > 3 ? max(1, atoi(argv[3])) : 1;
+    int numeroFragmentos = argc > 4 ? max(1, atoi(argv[4])) : 0;  // Zero usa uma Biblioteca simples.
+
+    GravadorTrace gravador;
+    if (!gravador.abrir(argv[1])) {
+        cerr << "Nao foi possivel criar o trace " << argv[1] << "." << endl;
+        return 1;
+    }
+    ResumoEstado resumo;
+    if (numeroFragmentos > 0) {
+        BibliotecaFragmentada biblioteca(numeroFragmentos, &gravador);
+        resumo = gravarCarga(biblioteca, operacoes, numeroThreads);
+    } else {
+        Biblioteca biblioteca;
+        biblioteca.gravador = &gravador;
+        resumo = gravarCarga(biblioteca, operacoes, numeroThreads);
+    }
+
+    cout << operacoes << " operacoes gravadas; estado final: " << resumo.livros << " livros, "
+         << resumo.usuarios << " usuarios, " << resumo.emprestimos << " emprestimos, "
+         << resumo.arquivados << " arquivados." << endl;
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Verifica o arquivo histórico de empréstimos: o que é arquivado volta idêntico pelas
+// buscas e pelas varreduras, depois de passar pela compressão por prefixo, pelas
+// diferenças de datas em zigue-zague, pelo índice esparso e pelas fusões de segmentos.
+// Uso: verificar_arquivo [rodadas] [emprestimos por rodada]
+// Compilar a partir de Library_manager_trees:
+//   g++ -O1 -g -fsanitize=address,undefined -I. testes/verificar_arquivo.cpp -o verificar_arquivo
+#include <iostream>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <tuple>
+#include <vector>
+#include "ArquivoEmprestimos.h"
+
+using namespace std;
+
+typedef tuple<string, string, string, string> Registro;
+
+Registro registro(const Emprestimo& e) {
+    return Registro(e.tituloLivro, e.idUsuario, e.dataEmprestimo, e.dataDevolucao);
+}
+
+string data(int dia, int mes, int ano) {
+    char texto[16];
+    snprintf(texto, sizeof(texto), "%02d-%02d-%04d", dia, mes, ano);
+    return texto;
+}
+
+// Empréstimo aleatório. Poucos ISBNs e usuários longos com prefixos em comum, muitos
+// registros por ISBN (que atravessam blocos), devoluções antes do empréstimo
+// (diferença negativa) e algumas datas fora do formato, gravadas como texto.
+Emprestimo sortear(mt19937& gerador, int universo) {
+    string isbn = "978" + to_string(gerador() % universo);
+    string usuario = "usuario-" + to_string(gerador() % 50);
+    int dia = 1 + gerador() % 31, mes = 1 + gerador() % 12, ano = 1990 + gerador() % 40;
+    string emprestimo = data(dia, mes, ano);
+    string devolucao = data(1 + gerador() % 31, 1 + gerador() % 12, ano + (int)(gerador() % 3) - 1);
+    switch (gerador() % 20) {
+        case 0: emprestimo = ""; break;
+        case 1: devolucao = "sem data"; break;
+        case 2: emprestimo = "1-1-2024"; break;
+    }
+    return Emprestimo(isbn, usuario, emprestimo, devolucao);
+}
+
+// Confere tamanho, varredura completa e a busca de cada ISBN contra a referência.
+bool conferir(const ArquivoEmprestimos& arquivo, const multimap<string, Registro>& referencia,
+              int universo, string& erro) {
+    if (arquivo.tamanho() != referencia.size()) {
+        erro = "tamanho " + to_string(arquivo.tamanho()) + " != " + to_string(referencia.size());
+        return false;
+    }
+    multiset<Registro> todos, esperados;
+    arquivo.percorrer([&](const Emprestimo& e) { todos.insert(registro(e)); });
+    for (const auto& par : referencia) esperados.insert(par.second);
+    if (todos != esperados) {
+        erro = "varredura difere da referencia";
+        return false;
+    }
+    // Também ISBNs ausentes, antes, entre e depois das chaves existentes.
+    for (int i = -1; i <= universo; i++) {
+        string isbn = i < 0 ? "977" : i == universo ? "979" : "978" + to_string(i);
+        vector<Emprestimo> achados;
+        size_t quantidade = arquivo.buscar(isbn, achados);
+        multiset<Registro> obtidos, esperadosIsbn;
+        for (const auto& e : achados) obtidos.insert(registro(e));
+        auto faixa = referencia.equal_range(isbn);
+        for (auto it = faixa.first; it != faixa.second; ++it) esperadosIsbn.insert(it->second);
+        if (quantidade != achados.size() || obtidos != esperadosIsbn) {
+            erro = "busca de " + isbn + ": " + to_string(obtidos.size()) + " de " + to_string(esperadosIsbn.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int rodadas = argc > 1 ? atoi(argv[1]) : 6;
+    int emprestimos = argc > 2 ? atoi(argv[2]) : 12000;
+    mt19937 gerador(5);
+
+    for (int rodada = 0; rodada < rodadas; rodada++) {
+        // Um segmento isolado devolve os registros na ordem em que foram gravados.
+        int universo = 5 + rodada * 60;
+        vector<Emprestimo> ordenados;
+        for (int i = 0; i < 1000; i++) ordenados.push_back(sortear(gerador, universo));
+        stable_sort(ordenados.begin(), ordenados.end(), [](const Emprestimo& a, const Emprestimo& b) {
+            return a.tituloLivro < b.tituloLivro;
+        });
+        SegmentoArquivo segmento(ordenados);
+        size_t posicao = 0;
+        bool igual = segmento.tamanho() == ordenados.size();
+        segmento.percorrer([&](const Emprestimo& e) {
+            igual = igual && posicao < ordenados.size() && registro(e) == registro(ordenados[posicao]);
+            posicao++;
+        });
+        if (!igual) {
+            cerr << "Rodada " << rodada << ": segmento nao reproduz os registros em ordem" << endl;
+            return 1;
+        }
+
+        // Arquivo completo: vários consolidados e fusões, conferidos no caminho.
+        ArquivoEmprestimos arquivo;
+        multimap<string, Registro> referencia;
+        string erro;
+        for (int i = 0; i < emprestimos; i++) {
+            Emprestimo e = sortear(gerador, universo);
+            referencia.emplace(e.tituloLivro, registro(e));
+            arquivo.arquivar(e);
+            if (i % 3000 == 2999 && !conferir(arquivo, referencia, universo, erro)) {
+                cerr << "Rodada " << rodada << ", emprestimo " << i << ": " << erro << endl;
+                return 1;
+            }
+        }
+        arquivo.consolidar();
+        if (!conferir(arquivo, referencia, universo, erro)) {
+            cerr << "Rodada " << rodada << ", consolidado: " << erro << endl;
+            return 1;
+        }
+
+        // Expurgo por data de devolução, como no menu, e um que esvazia o arquivo.
+        auto antigo = [](const Emprestimo& e) { return e.dataDevolucao.size() == 10 && e.dataDevolucao.substr(6) < "2005"; };
+        size_t esperados = 0;
+        for (auto it = referencia.begin(); it != referencia.end();) {
+            Emprestimo e(get<0>(it->second), get<1>(it->second), get<2>(it->second), get<3>(it->second));
+            if (antigo(e)) { it = referencia.erase(it); esperados++; } else ++it;
+        }
+        if (arquivo.expurgar(antigo) != esperados || !conferir(arquivo, referencia, universo, erro)) {
+            cerr << "Rodada " << rodada << ", expurgo: " << (erro.empty() ? "contagem errada" : erro) << endl;
+            return 1;
+        }
+        size_t restantes = referencia.size();
+        referencia.clear();
+        if (arquivo.expurgar([](const Emprestimo&) { return true; }) != restantes ||
+            !conferir(arquivo, referencia, universo, erro) || arquivo.bytesComprimidos() != 0) {
+            cerr << "Rodada " << rodada << ", esvaziando: " << (erro.empty() ? "contagem errada" : erro) << endl;
+            return 1;
+        }
+    }
+
+    cout << "Arquivo: " << rodadas << " rodadas de " << emprestimos << " emprestimos, historico preservado." << endl;
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Verifica as invariantes da árvore B de empréstimos sob inserções e remoções
+// aleatórias, comparando o conteúdo com um std::set de referência.
+// Uso: verificar_btree [rodadas] [operacoes por rodada]
+// Compilar a partir de Library_manager_trees:
+//   g++ -O1 -g -fsanitize=address,undefined -I. testes/verificar_btree.cpp -o verificar_btree
+#include <iostream>
+#include <set>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <vector>
+#include "Emprestimo.h"
+
+using namespace std;
+
+// Confere um nó e sua subárvore: número de chaves e de filhos, ordem das chaves,
+// limites herdados do pai e profundidade igual para todas as folhas.
+bool verificarNo(BTreeNode* node, bool raiz, int profundidade, int& profundidadeFolhas,
+                 const string* menor, const string* maior, size_t& chaves, string& erro) {
+    size_t n = node->emprestimos.size();
+    if (n > 2 * T - 1 || (!raiz && n < T - 1)) {
+        erro = "no com " + to_string(n) + " chaves";
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const string& chave = node->emprestimos[i].tituloLivro;
+        if ((i > 0 && !(node->emprestimos[i - 1].tituloLivro < chave)) ||
+            (menor && !(*menor < chave)) || (maior && !(chave < *maior))) {
+            erro = "chave fora de ordem: " + chave;
+            return false;
+        }
+    }
+    chaves += n;
+
+    if (node->folha) {
+        if (!node->filhos.empty()) {
+            erro = "folha com filhos";
+            return false;
+        }
+        if (profundidadeFolhas < 0) profundidadeFolhas = profundidade;
+        if (profundidadeFolhas != profundidade) {
+            erro = "folhas em profundidades diferentes";
+            return false;
+        }
+        return true;
+    }
+
+    if (node->filhos.size() != n + 1) {
+        erro = "no interno com " + to_string(node->filhos.size()) + " filhos e " + to_string(n) + " chaves";
+        return false;
+    }
+    for (size_t i = 0; i <= n; i++) {
+        const string* limiteMenor = i > 0 ? &node->emprestimos[i - 1].tituloLivro : menor;
+        const string* limiteMaior = i < n ? &node->emprestimos[i].tituloLivro : maior;
+        if (!verificarNo(node->filhos[i], false, profundidade + 1, profundidadeFolhas,
+                         limiteMenor, limiteMaior, chaves, erro)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Confere a árvore inteira contra o conjunto de referência.
+bool verificar(BTree& arvore, const set<string>& referencia, string& erro) {
+    int profundidadeFolhas = -1;
+    size_t chaves = 0;
+    if (!verificarNo(arvore.root, true, 0, profundidadeFolhas, nullptr, nullptr, chaves, erro)) {
+        return false;
+    }
+    if (chaves != referencia.size() || arvore.size() != referencia.size()) {
+        erro = to_string(chaves) + " chaves na arvore, " + to_string(referencia.size()) + " esperadas";
+        return false;
+    }
+    for (const auto& chave : referencia) {
+        if (!arvore.search(arvore.root, chave)) {
+            erro = "chave perdida: " + chave;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int rodadas = argc > 1 ? atoi(argv[1]) : 20;
+    int operacoes = argc > 2 ? atoi(argv[2]) : 20000;
+    mt19937 gerador(7);
+
+    for (int rodada = 0; rodada < rodadas; rodada++) {
+        BTree arvore;
+        set<string> referencia;
+        // Poucas chaves distintas, para que remoções acertem chaves existentes com frequência
+        // e passem por todos os casos de empréstimo e junção de nós.
+        int universo = 500 + rodada * 250;
+        string erro;
+
+        for (int i = 0; i < operacoes; i++) {
+            string chave = to_string(gerador() % universo);
+            if (gerador() % 2) {
+                if (referencia.insert(chave).second) {
+                    arvore.insert(Emprestimo(chave, "u", "01-01-2024", "10-01-2024"));
+                }
+            } else {
+                arvore.root = arvore.remove(arvore.root, chave);
+                referencia.erase(chave);
+            }
+            if (i % 500 == 0 && !verificar(arvore, referencia, erro)) {
+                cerr << "Rodada " << rodada << ", operacao " << i << ": " << erro << endl;
+                return 1;
+            }
+        }
+
+        // Remoção em lote: um lote pequeno (chave a chave), um grande (reconstrução) e
+        // um predicado, cada um com chaves ausentes e repetidas misturadas.
+        for (size_t tamanhoLote : {(size_t)3, referencia.size() / 2 + 1}) {
+            vector<string> lote;
+            for (size_t i = 0; i < tamanhoLote; i++) {
+                lote.push_back(to_string(gerador() % (universo + 50)));
+            }
+            lote.push_back(lote.front());
+            vector<Emprestimo> removidos;
+            set<string> esperados;
+            for (const auto& chave : set<string>(lote.begin(), lote.end())) {
+                if (referencia.erase(chave)) esperados.insert(chave);
+            }
+            set<string> devolvidos;
+            size_t quantidade = arvore.removeBatch(lote, &removidos);
+            for (const auto& emprestimo : removidos) {
+                devolvidos.insert(emprestimo.tituloLivro);
+            }
+            if (quantidade != esperados.size() || removidos.size() != esperados.size() || devolvidos != esperados ||
+                !verificar(arvore, referencia, erro)) {
+                cerr << "Rodada " << rodada << ", lote de " << tamanhoLote << ": " << (erro.empty() ? "contagem errada" : erro) << endl;
+                return 1;
+            }
+        }
+        size_t esperados = 0;
+        for (auto it = referencia.begin(); it != referencia.end();) {
+            if (it->back() == '7') { it = referencia.erase(it); esperados++; } else ++it;
+        }
+        if (arvore.removeIf([](const Emprestimo& e) { return e.tituloLivro.back() == '7'; }) != esperados ||
+            !verificar(arvore, referencia, erro)) {
+            cerr << "Rodada " << rodada << ", predicado: " << (erro.empty() ? "contagem errada" : erro) << endl;
+            return 1;
+        }
+
+        // Esvazia a árvore, o que obriga a raiz a perder níveis.
+        for (const auto& chave : set<string>(referencia)) {
+            arvore.root = arvore.remove(arvore.root, chave);
+            referencia.erase(chave);
+        }
+        if (!verificar(arvore, referencia, erro)) {
+            cerr << "Rodada " << rodada << ", esvaziando: " << erro << endl;
+            return 1;
+        }
+    }
+
+    cout << "Arvore B: " << rodadas << " rodadas de " << operacoes << " operacoes, invariantes mantidas." << endl;
+    return 0;
+}
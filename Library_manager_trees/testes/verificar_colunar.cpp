@@ -0,0 +1,132 @@
+// Compara os kernels do catálogo colunar (vetoriais e escalares) com uma referência
+// ingênua, calculada direto dos livros, em catálogos aleatórios de vários tamanhos.
+// Uso: verificar_colunar [rodadas]
+// Compilar a partir de Library_manager_trees:
+//   g++ -O1 -g -fsanitize=address,undefined -I. testes/verificar_colunar.cpp -o verificar_colunar
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <vector>
+#include "CatalogoColunar.h"
+
+using namespace std;
+
+// Valores de páginas difíceis: negativos, zero, limites de faixa e extremos de int32.
+int32_t sortearPaginas(mt19937& gerador) {
+    switch (gerador() % 8) {
+        case 0: return -(int32_t)(gerador() % 1000);
+        case 1: return 0;
+        case 2: return (int32_t)(gerador() % 11) * 100;
+        case 3: return gerador() % 2 ? INT32_MAX : INT32_MIN;
+        case 4: return (int32_t)gerador();
+        default: return 1 + (int32_t)(gerador() % 1500);
+    }
+}
+
+// Faixa de referência, calculada em 64 bits e sem atalhos.
+size_t faixaReferencia(long long paginas, long long largura, long long numFaixas) {
+    if (paginas < largura) return 0;
+    long long faixa = paginas / largura;
+    return faixa >= numFaixas ? numFaixas - 1 : faixa;
+}
+
+bool conferir(const CatalogoColunar& catalogo, const map<string, Livro>& livros, string& erro) {
+    if (catalogo.tamanho() != livros.size()) {
+        erro = "tamanho " + to_string(catalogo.tamanho()) + " != " + to_string(livros.size());
+        return false;
+    }
+
+    long long soma = 0;
+    int32_t menor = INT32_MAX, maior = INT32_MIN;
+    map<string, pair<size_t, long long>> porAutor;
+    for (const auto& par : livros) {
+        const Livro& livro = par.second;
+        soma += livro.numeroPaginas;
+        menor = min(menor, (int32_t)livro.numeroPaginas);
+        maior = max(maior, (int32_t)livro.numeroPaginas);
+        porAutor[livro.autor].first++;
+        porAutor[livro.autor].second += livro.numeroPaginas;
+    }
+
+    if (catalogo.somaPaginas() != soma) {
+        erro = "soma de paginas";
+        return false;
+    }
+    int mn = 0, mx = 0;
+    if (catalogo.minMaxPaginas(mn, mx) != !livros.empty() || (!livros.empty() && (mn != menor || mx != maior))) {
+        erro = "menor/maior";
+        return false;
+    }
+
+    for (int largura : {1, 7, 100, 1000000, INT32_MAX}) {
+        for (int numFaixas : {1, 2, 10, 64, 65, 300}) {
+            vector<size_t> esperado(numFaixas, 0);
+            for (const auto& par : livros) {
+                esperado[faixaReferencia(par.second.numeroPaginas, largura, numFaixas)]++;
+            }
+            if (catalogo.histogramaPaginas(largura, numFaixas) != esperado) {
+                erro = "histograma largura " + to_string(largura) + ", " + to_string(numFaixas) + " faixas";
+                return false;
+            }
+        }
+    }
+    if (!catalogo.histogramaPaginas(0, 10).empty() || !catalogo.histogramaPaginas(-5, 10).empty() ||
+        !catalogo.histogramaPaginas(100, 0).empty()) {
+        erro = "histograma aceitou largura ou faixas nao positivas";
+        return false;
+    }
+
+    vector<size_t> livrosAutor = catalogo.livrosPorAutor();
+    vector<long long> paginasAutor = catalogo.paginasPorAutor();
+    for (size_t id = 0; id < catalogo.autores.size(); id++) {
+        auto it = porAutor.find(catalogo.autores[id]);
+        size_t quantidade = it == porAutor.end() ? 0 : it->second.first;
+        long long paginas = it == porAutor.end() ? 0 : it->second.second;
+        if (livrosAutor[id] != quantidade || paginasAutor[id] != paginas) {
+            erro = "agrupamento do autor " + catalogo.autores[id];
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int rodadas = argc > 1 ? atoi(argv[1]) : 30;
+    mt19937 gerador(11);
+    cout << "AVX2 " << (CatalogoColunar::simdDisponivel() ? "disponivel" : "indisponivel") << endl;
+
+    for (int rodada = 0; rodada < rodadas; rodada++) {
+        CatalogoColunar catalogo;
+        map<string, Livro> livros;
+        // Tamanhos pequenos e não múltiplos de 8 exercitam as sobras dos laços vetoriais.
+        size_t tamanho = rodada < 10 ? rodada : gerador() % 5000;
+        int numAutores = 1 + gerador() % 40;
+        for (size_t i = 0; i < tamanho; i++) {
+            string isbn = to_string(gerador() % (tamanho * 2 + 1));
+            Livro livro(isbn, "t", "autor" + to_string(gerador() % numAutores), sortearPaginas(gerador));
+            if (livros.emplace(isbn, livro).second) catalogo.adicionar(livro);
+        }
+        // Algumas remoções, que trocam linhas de lugar.
+        for (size_t i = 0; i < tamanho / 4; i++) {
+            string isbn = to_string(gerador() % (tamanho * 2 + 1));
+            if (livros.erase(isbn) != catalogo.remover(isbn)) {
+                cerr << "Rodada " << rodada << ": remocao divergente de " << isbn << endl;
+                return 1;
+            }
+        }
+
+        for (bool simd : {true, false}) {
+            catalogo.permitirSimd = simd;
+            string erro;
+            if (!conferir(catalogo, livros, erro)) {
+                cerr << "Rodada " << rodada << (simd ? " (vetorial)" : " (escalar)") << ": " << erro << endl;
+                return 1;
+            }
+        }
+    }
+
+    cout << "Catalogo colunar: " << rodadas << " rodadas, kernels conferem com a referencia." << endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Verifica o formato do trace: operações comuns e operações acima dos limites de um
+// registro (muitos argumentos, argumentos longos) voltam idênticas pelo leitor, e um
+// arquivo truncado no meio de uma continuação termina a leitura sem operação parcial.
+// Uso: verificar_trace [arquivo temporario]
+// Compilar a partir de Library_manager_trees:
+//   g++ -O1 -g -fsanitize=address,undefined -I. testes/verificar_trace.cpp -o verificar_trace
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Trace.h"
+
+using namespace std;
+
+struct Esperada {
+    TipoOperacao tipo;
+    vector<string> argumentos;
+};
+
+// Lê o arquivo inteiro e confere contra as operações esperadas.
+bool conferir(const string& caminho, const vector<Esperada>& esperadas, string& erro) {
+    LeitorTrace leitor;
+    if (!leitor.abrir(caminho)) {
+        erro = "cabecalho recusado";
+        return false;
+    }
+    OperacaoTrace operacao;
+    size_t lidas = 0;
+    while (leitor.proxima(operacao)) {
+        if (lidas >= esperadas.size()) {
+            erro = "operacao alem das gravadas";
+            return false;
+        }
+        const Esperada& esperada = esperadas[lidas];
+        if (operacao.tipo != esperada.tipo || operacao.argumentos != esperada.argumentos) {
+            erro = "operacao " + to_string(lidas) + " difere (" + to_string(operacao.argumentos.size()) +
+                   " argumentos, esperados " + to_string(esperada.argumentos.size()) + ")";
+            return false;
+        }
+        lidas++;
+    }
+    if (lidas != esperadas.size()) {
+        erro = to_string(lidas) + " operacoes lidas de " + to_string(esperadas.size());
+        return false;
+    }
+    return true;
+}
+
+// Grava as operações e retorna o tamanho do arquivo, ou -1 se não puder criá-lo.
+long tamanhoDoTrace(const string& caminho, const vector<Esperada>& operacoes) {
+    GravadorTrace gravador;
+    if (!gravador.abrir(caminho)) return -1;
+    for (const auto& operacao : operacoes) gravador.registrar(operacao.tipo, operacao.argumentos);
+    gravador.fechar();
+    FILE* arquivo = fopen(caminho.c_str(), "rb");
+    fseek(arquivo, 0, SEEK_END);
+    long tamanho = ftell(arquivo);
+    fclose(arquivo);
+    return tamanho;
+}
+
+int main(int argc, char* argv[]) {
+    string caminho = argc > 1 ? argv[1] : "verificar_trace.tmp";
+
+    // Argumento que atravessa três registros, com um byte de cada valor para que um
+    // pedaço fora do lugar apareça na comparação.
+    string longo(3 * MAXIMO_TAMANHO_ARGUMENTO + 17, '\0');
+    for (size_t i = 0; i < longo.size(); i++) longo[i] = (char)(i * 31 + i / 251);
+
+    vector<string> lote = {"10-10-2026"};
+    for (int i = 0; i < 70000; i++) lote.push_back("978" + to_string(1000000 + i));
+
+    // Exatamente no limite: não gera continuação.
+    vector<string> noLimite(MAXIMO_ARGUMENTOS_TRACE, "x");
+    noLimite[0] = string(MAXIMO_TAMANHO_ARGUMENTO, 'a');
+
+    vector<Esperada> esperadas = {
+        {OP_CADASTRAR_LIVRO, {"9780000000001", "Titulo", "Autor", "100"}},
+        {OP_DEVOLVER_LOTE, lote},
+        {OP_BUSCAR_LIVRO, {"9780000000001"}},
+        {OP_EXPORTAR_RELATORIO, {"livros", longo, "", longo.substr(5)}},
+        {OP_LISTAR_LIVROS, {}},
+        {OP_EXPORTAR_RELATORIO, noLimite},
+        {OP_EXPORTAR_RELATORIO, vector<string>(2 * MAXIMO_ARGUMENTOS_TRACE + 3, "")},
+        {OP_COMPACTAR, {}},
+    };
+
+    if (tamanhoDoTrace(caminho, esperadas) < 0) {
+        cerr << "Nao foi possivel criar " << caminho << endl;
+        return 1;
+    }
+    string erro;
+    if (!conferir(caminho, esperadas, erro)) {
+        cerr << "Trace completo: " << erro << endl;
+        remove(caminho.c_str());
+        return 1;
+    }
+
+    // Truncado dentro da continuação do argumento longo: só as três primeiras
+    // operações são lidas. O corte fica meio pedaço depois do primeiro registro dele.
+    long antes = tamanhoDoTrace(caminho, vector<Esperada>(esperadas.begin(), esperadas.begin() + 3));
+    long completo = tamanhoDoTrace(caminho, esperadas);
+    size_t corte = antes + MAXIMO_TAMANHO_ARGUMENTO * 3 / 2;
+    vector<char> bytes(completo);
+    FILE* arquivo = fopen(caminho.c_str(), "rb");
+    bool lido = arquivo && fread(bytes.data(), 1, bytes.size(), arquivo) == bytes.size();
+    if (arquivo) fclose(arquivo);
+    arquivo = fopen(caminho.c_str(), "wb");
+    fwrite(bytes.data(), 1, corte, arquivo);
+    fclose(arquivo);
+    esperadas.resize(3);
+    bool truncadoOk = lido && conferir(caminho, esperadas, erro);
+    remove(caminho.c_str());
+    if (!truncadoOk) {
+        cerr << "Trace truncado: " << (lido ? erro : "arquivo ilegivel") << endl;
+        return 1;
+    }
+
+    cout << "Trace: operacoes comuns e continuacoes preservadas, truncamento recusado." << endl;
+    return 0;
+}